@@ -0,0 +1,103 @@
+#include "atoms.h"
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+
+constexpr const char* kNames[] = {
+    "",
+#define X(id, name) name,
+    HTML_ATOMS(X)
+#undef X
+};
+static_assert(sizeof(kNames) / sizeof(kNames[0]) == kKnownAtoms, "atom table out of sync");
+static_assert(kKnownAtoms < 256, "slots hold 8-bit atom ids");
+
+constexpr char Lower(char c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+constexpr size_t Length(const char* s) {
+    size_t n = 0;
+    while (s[n]) n++;
+    return n;
+}
+
+constexpr uint32_t Hash(uint32_t seed, const char* s, size_t n) {
+    uint32_t h = seed;
+    for (size_t i = 0; i < n; i++) h = (h ^ static_cast<unsigned char>(Lower(s[i]))) * 16777619u;
+    return h ^ (h >> 15);
+}
+
+// Open table with no collisions among the known names: a slot holds the one
+// atom that can hash there, so a lookup is one hash and one compare.
+constexpr size_t kSlots = 4096;
+
+struct PerfectTable {
+    uint32_t seed = 0;
+    uint8_t slots[kSlots] = {};
+};
+
+// Tries seeds until every known name lands in its own slot. Runs in the
+// compiler; the static_assert below fails the build if no seed works.
+constexpr PerfectTable BuildTable() {
+    for (uint32_t seed = 2166136261u; seed < 2166136261u + 4096; seed++) {
+        PerfectTable table;
+        table.seed = seed;
+        bool ok = true;
+        for (size_t i = 1; i < kKnownAtoms && ok; i++) {
+            uint8_t& slot = table.slots[Hash(seed, kNames[i], Length(kNames[i])) % kSlots];
+            ok = slot == 0;
+            slot = static_cast<uint8_t>(i);
+        }
+        if (ok) return table;
+    }
+    return PerfectTable();
+}
+
+constexpr PerfectTable kTable = BuildTable();
+static_assert(kTable.seed != 0, "no perfect hash seed for the atom table");
+
+// Names outside HTML_ATOMS, in id order past kKnownAtoms. Never shrinks; a
+// deque keeps AtomName() pointers stable as it grows.
+std::mutex g_poolMutex;
+std::unordered_map<std::string, Atom> g_pool;
+std::deque<std::string> g_poolNames;
+
+}  // namespace
+
+Atom LookupAtom(const char* name, size_t length) {
+    uint8_t index = kTable.slots[Hash(kTable.seed, name, length) % kSlots];
+    if (!index) return Atom::None;
+    const char* known = kNames[index];
+    for (size_t i = 0; i < length; i++) {
+        if (known[i] == '\0' || Lower(name[i]) != known[i]) return Atom::None;
+    }
+    return known[length] == '\0' ? static_cast<Atom>(index) : Atom::None;
+}
+
+Atom InternAtom(const char* name, size_t length) {
+    if (length == 0) return Atom::None;
+    Atom known = LookupAtom(name, length);
+    if (known != Atom::None) return known;
+
+    std::string lower(name, length);
+    for (char& c : lower) c = Lower(c);
+    std::lock_guard<std::mutex> lock(g_poolMutex);
+    auto it = g_pool.find(lower);
+    if (it != g_pool.end()) return it->second;
+    size_t id = kKnownAtoms + g_poolNames.size();
+    if (id > UINT16_MAX) return Atom::None;
+    Atom atom = static_cast<Atom>(id);
+    g_poolNames.push_back(lower);
+    g_pool.emplace(std::move(lower), atom);
+    return atom;
+}
+
+const char* AtomName(Atom atom) {
+    size_t id = static_cast<size_t>(atom);
+    if (id < kKnownAtoms) return kNames[id];
+    std::lock_guard<std::mutex> lock(g_poolMutex);
+    return id - kKnownAtoms < g_poolNames.size() ? g_poolNames[id - kKnownAtoms].c_str() : "";
+}
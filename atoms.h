@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Every tag and attribute name the browser knows by heart. Tags and
+// attributes share one namespace, so "style" or "title" is a single atom
+// whichever role it plays.
+#define HTML_ATOMS(X)                                                                          \
+    X(Root, "#root") X(Text, "#text")                                                          \
+    /* elements */                                                                             \
+    X(A, "a") X(Abbr, "abbr") X(Address, "address") X(Area, "area") X(Article, "article")      \
+    X(Aside, "aside") X(Audio, "audio") X(B, "b") X(Base, "base") X(Bdi, "bdi") X(Bdo, "bdo")  \
+    X(Blockquote, "blockquote") X(Body, "body") X(Br, "br") X(Button, "button")                \
+    X(Canvas, "canvas") X(Caption, "caption") X(Center, "center") X(Cite, "cite")              \
+    X(Code, "code") X(Col, "col") X(Colgroup, "colgroup") X(Data, "data")                      \
+    X(Datalist, "datalist") X(Dd, "dd") X(Del, "del") X(Details, "details") X(Dfn, "dfn")      \
+    X(Dialog, "dialog") X(Div, "div") X(Dl, "dl") X(Dt, "dt") X(Em, "em") X(Embed, "embed")    \
+    X(Fieldset, "fieldset") X(Figcaption, "figcaption") X(Figure, "figure") X(Font, "font")    \
+    X(Footer, "footer") X(Form, "form") X(Frame, "frame") X(Frameset, "frameset")              \
+    X(H1, "h1") X(H2, "h2") X(H3, "h3") X(H4, "h4") X(H5, "h5") X(H6, "h6") X(Head, "head")     \
+    X(Header, "header") X(Hgroup, "hgroup") X(Hr, "hr") X(Html, "html") X(I, "i")              \
+    X(Iframe, "iframe") X(Img, "img") X(Input, "input") X(Ins, "ins") X(Kbd, "kbd")            \
+    X(Label, "label") X(Legend, "legend") X(Li, "li") X(Link, "link") X(Main, "main")          \
+    X(Map, "map") X(Mark, "mark") X(Math, "math") X(Menu, "menu") X(Meta, "meta")              \
+    X(Meter, "meter") X(Nav, "nav") X(Noscript, "noscript") X(Object, "object") X(Ol, "ol")    \
+    X(Optgroup, "optgroup") X(Option, "option") X(Output, "output") X(P, "p")                  \
+    X(Param, "param") X(Picture, "picture") X(Pre, "pre") X(Progress, "progress") X(Q, "q")    \
+    X(Rp, "rp") X(Rt, "rt") X(Ruby, "ruby") X(S, "s") X(Samp, "samp") X(Script, "script")      \
+    X(Search, "search") X(Section, "section") X(Select, "select") X(Slot, "slot")              \
+    X(Small, "small") X(Source, "source") X(Span, "span") X(Strike, "strike")                  \
+    X(Strong, "strong") X(Style, "style") X(Sub, "sub") X(Summary, "summary") X(Sup, "sup")    \
+    X(Svg, "svg") X(Table, "table") X(Tbody, "tbody") X(Td, "td") X(Template, "template")      \
+    X(Textarea, "textarea") X(Tfoot, "tfoot") X(Th, "th") X(Thead, "thead") X(Time, "time")    \
+    X(Title, "title") X(Tr, "tr") X(Track, "track") X(Tt, "tt") X(U, "u") X(Ul, "ul")          \
+    X(Var, "var") X(Video, "video") X(Wbr, "wbr")                                              \
+    /* attributes */                                                                           \
+    X(Accept, "accept") X(Action, "action") X(Align, "align") X(Alt, "alt") X(Async, "async")  \
+    X(Autocomplete, "autocomplete") X(Bgcolor, "bgcolor") X(Border, "border")                  \
+    X(Charset, "charset") X(Checked, "checked") X(Class, "class") X(Color, "color")            \
+    X(Cols, "cols") X(Colspan, "colspan") X(Content, "content") X(Crossorigin, "crossorigin")  \
+    X(Decoding, "decoding") X(Defer, "defer") X(Dir, "dir") X(Disabled, "disabled")            \
+    X(Download, "download") X(Face, "face") X(Height, "height") X(Hidden, "hidden")            \
+    X(Href, "href") X(Hreflang, "hreflang") X(HttpEquiv, "http-equiv") X(Id, "id")             \
+    X(Integrity, "integrity") X(Lang, "lang") X(Loading, "loading") X(Media, "media")          \
+    X(Method, "method") X(Name, "name") X(Nonce, "nonce") X(Onclick, "onclick")                \
+    X(Onload, "onload") X(Placeholder, "placeholder") X(Property, "property")                  \
+    X(Referrerpolicy, "referrerpolicy") X(Rel, "rel") X(Role, "role") X(Rows, "rows")          \
+    X(Rowspan, "rowspan") X(Selected, "selected") X(Size, "size") X(Sizes, "sizes")            \
+    X(Src, "src") X(Srcset, "srcset") X(Tabindex, "tabindex") X(Target, "target")              \
+    X(Type, "type") X(Valign, "valign") X(Value, "value") X(Width, "width")
+
+// Small integer id for a tag or attribute name. Known names are enumerators;
+// anything else gets an id past kKnownAtoms from a process-wide pool.
+enum class Atom : uint16_t {
+    None = 0,
+#define X(id, name) id,
+    HTML_ATOMS(X)
+#undef X
+};
+
+constexpr size_t kKnownAtoms = static_cast<size_t>(Atom::Width) + 1;
+
+// Known names only, ASCII case-insensitive; Atom::None otherwise. Lock-free.
+Atom LookupAtom(const char* name, size_t length);
+
+// Known names, then the pool, adding the lowercased name if it is new.
+// Thread-safe. Returns Atom::None for an empty name or once the pool is full.
+Atom InternAtom(const char* name, size_t length);
+inline Atom InternAtom(const std::string& name) { return InternAtom(name.data(), name.size()); }
+
+// Lowercase name of an atom; "" for Atom::None.
+const char* AtomName(Atom atom);
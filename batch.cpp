@@ -0,0 +1,322 @@
+#include "batch.h"
+#include "encoding.h"
+#include "fonts.h"
+#include "html_parser.h"
+#include "page_render.h"
+#include "trace.h"
+#include "url.h"
+#include "imgui.h"
+#include <curl/curl.h>
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+struct Page {
+    size_t index = 0;
+    std::string url;
+    std::string body;
+    std::string contentType;
+    HTMLNode root;
+    HTMLParseStats dom;
+    bool ok = false;
+    long status = 0;
+    int64_t started = 0;   // fetch issued
+    int64_t fetched = 0;
+    int64_t parseStart = 0;
+    int64_t parsed = 0;
+    int64_t layoutStart = 0;
+    int64_t done = 0;
+};
+
+bool LooksLikeHTML(const ArchiveEntry& entry) {
+    if (entry.status != 200) return false;
+    std::string type = entry.Header("Content-Type");
+    if (type.empty()) return entry.body.find('<') != std::string::npos;
+    for (char& c : type) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    return type.find("html") != std::string::npos;
+}
+
+bool ReadInput(const BatchOptions& options, std::vector<std::string>& urls) {
+    if (HttpArchive::IsArchive(options.input)) {
+        HttpArchive archive;
+        if (!archive.Load(options.input)) return false;
+        for (const ArchiveEntry& entry : archive.Entries()) {
+            if (LooksLikeHTML(entry)) urls.push_back(entry.url);
+        }
+        return true;
+    }
+    std::ifstream list(options.input);
+    if (!list) {
+        std::cerr << "[Batch] Cannot open " << options.input << std::endl;
+        return false;
+    }
+    std::string line;
+    while (std::getline(list, line)) {
+        line = line.substr(0, line.find('#'));
+        size_t begin = line.find_first_not_of(" \t\r");
+        if (begin == std::string::npos) continue;
+        size_t end = line.find_last_not_of(" \t\r");
+        urls.push_back(line.substr(begin, end - begin + 1));
+    }
+    return true;
+}
+
+bool IsBlock(Atom tag) {
+    switch (tag) {
+    case Atom::P: case Atom::Div: case Atom::Br: case Atom::Li: case Atom::Tr:
+    case Atom::H1: case Atom::H2: case Atom::H3: case Atom::H4: case Atom::H5: case Atom::H6:
+    case Atom::Section: case Atom::Article: case Atom::Header: case Atom::Footer:
+    case Atom::Blockquote: case Atom::Pre: case Atom::Table:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void ExtractText(const HTMLNode& node, std::string& out) {
+    if (node.tag == Atom::Text) {
+        if (!out.empty() && out.back() != '\n') out += ' ';
+        out += node.text;
+        return;
+    }
+    if (node.tag == Atom::Script || node.tag == Atom::Style) return;
+    for (const HTMLNode& child : node.children) ExtractText(child, out);
+    if (IsBlock(node.tag) && !out.empty() && out.back() != '\n') out += '\n';
+}
+
+void WriteDisplayList(FILE* f, const Page& page, const ImDrawData* data) {
+    fprintf(f, "# %s\n", page.url.c_str());
+    for (int i = 0; i < data->CmdListsCount; i++) {
+        const ImDrawList* list = data->CmdLists[i];
+        fprintf(f, "list %d vtx %d idx %d cmds %d\n", i, list->VtxBuffer.Size, list->IdxBuffer.Size,
+                list->CmdBuffer.Size);
+        for (const ImDrawCmd& cmd : list->CmdBuffer) {
+            fprintf(f, "  cmd elems %u tex %llu clip %.0f %.0f %.0f %.0f\n", cmd.ElemCount,
+                    static_cast<unsigned long long>(cmd.GetTexID()),
+                    cmd.ClipRect.x, cmd.ClipRect.y, cmd.ClipRect.z, cmd.ClipRect.w);
+        }
+    }
+}
+
+double Percentile(std::vector<double>& values, double p) {
+    if (values.empty()) return 0;
+    size_t rank = static_cast<size_t>(p * (values.size() - 1) + 0.5);
+    std::nth_element(values.begin(), values.begin() + rank, values.end());
+    return values[rank];
+}
+
+}  // namespace
+
+int RunBatch(const BatchOptions& options) {
+    std::vector<std::string> urls;
+    if (!ReadInput(options, urls)) return 1;
+    if (urls.empty()) {
+        std::cerr << "[Batch] No pages in " << options.input << std::endl;
+        return 1;
+    }
+    NetworkOptions network = options.network;
+    if (HttpArchive::IsArchive(options.input) && network.mode == NetworkOptions::Mode::Live) {
+        network.mode = NetworkOptions::Mode::Replay;
+        network.archivePath = options.input;
+    }
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    ImGui::CreateContext();
+    ImGuiIO& io = ImGui::GetIO();
+    io.IniFilename = nullptr;
+    io.DisplaySize = ImVec2(static_cast<float>(options.width), static_cast<float>(options.height));
+    io.DeltaTime = 1.0f / 60.0f;
+    FontManager fonts(io.Fonts);
+
+    std::vector<Page> pages(urls.size());
+    for (size_t i = 0; i < urls.size(); i++) {
+        pages[i].index = i;
+        pages[i].url = urls[i];
+    }
+
+    // parse stage: workers take fetched pages, the main thread takes them back
+    std::mutex mutex;
+    std::condition_variable parseCv, doneCv;
+    std::deque<Page*> toParse, parsed;
+    bool quit = false;
+    int parseThreads = options.parseThreads > 0 ? options.parseThreads
+                                                : std::max(1, static_cast<int>(std::thread::hardware_concurrency()) / 2);
+    std::vector<std::thread> workers;
+    for (int i = 0; i < parseThreads; i++) {
+        workers.emplace_back([&] {
+            trace::SetThreadName("parse");
+            while (true) {
+                Page* page;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    parseCv.wait(lock, [&] { return quit || !toParse.empty(); });
+                    if (quit) return;
+                    page = toParse.front();
+                    toParse.pop_front();
+                }
+                page->parseStart = trace::NowUs();
+                DecodeToUTF8(page->body, page->contentType);
+                page->root = ParseHTML(page->body, &page->dom);
+                std::string().swap(page->body);
+                page->parsed = trace::NowUs();
+                std::lock_guard<std::mutex> lock(mutex);
+                parsed.push_back(page);
+                doneCv.notify_one();
+            }
+        });
+    }
+
+    FILE* index = nullptr;
+    if (options.dump != BatchDump::None) {
+        index = fopen((options.outDir + "/index.tsv").c_str(), "w");
+        if (!index) {
+            std::cerr << "[Batch] Cannot write to " << options.outDir << std::endl;
+        }
+    }
+
+    int64_t batchStart = trace::NowUs();
+    size_t next = 0, finished = 0;
+    int inPipeline = 0;
+    int failed = 0;
+    {
+        ResourceLoader loader(1, network);  // no images, so a single decode thread idles
+        CancelToken token = MakeCancelToken();
+        PageRenderHooks hooks;  // no images, links inert
+        std::unordered_map<std::string, std::vector<Page*>> fetching;  // by URLCacheKey
+
+        auto finish = [&](Page& page) {
+            page.done = trace::NowUs();
+            finished++;
+            inPipeline--;
+            if (!page.ok) failed++;
+            if (index) {
+                fprintf(index, "%zu\t%ld\t%.1f\t%d\t%d\t%s\n", page.index, page.status,
+                        (page.done - page.started) / 1000.0, page.dom.nodes, page.dom.maxDepth, page.url.c_str());
+            }
+        };
+
+        while (finished < pages.size()) {
+            // backpressure: a page holds its slot from fetch until its dump is written
+            while (inPipeline < options.concurrency && next < pages.size()) {
+                Page& page = pages[next++];
+                inPipeline++;
+                page.started = trace::NowUs();
+                // a URL listed twice is fetched once for every page waiting on it,
+                // so none is handed a body another already took
+                std::string key(URLCacheKey(page.url));
+                std::vector<Page*>& waiting = fetching[key];
+                waiting.push_back(&page);
+                if (waiting.size() > 1) continue;
+                loader.LoadDocument(page.url, token, [&, key](Response& response) {
+                    std::vector<Page*> waiting = std::move(fetching[key]);
+                    fetching.erase(key);
+                    for (size_t i = 0; i < waiting.size(); i++) {
+                        Page* p = waiting[i];
+                        p->fetched = trace::NowUs();
+                        p->status = response.status;
+                        if (!response.ok || response.status >= 400) {
+                            std::cerr << "[Batch] " << p->url << ": "
+                                      << (response.error.empty() ? "HTTP " + std::to_string(response.status) : response.error)
+                                      << std::endl;
+                            finish(*p);
+                            continue;
+                        }
+                        // the last page takes the body, the others copy it
+                        if (i + 1 < waiting.size()) {
+                            p->body.resize(response.body.Size());
+                            response.body.Read(0, &p->body[0], p->body.size());
+                            p->contentType = response.contentType;
+                        } else {
+                            p->body = response.body.TakeString();
+                            p->contentType = std::move(response.contentType);
+                        }
+                        std::lock_guard<std::mutex> lock(mutex);
+                        toParse.push_back(p);
+                        parseCv.notify_one();
+                    }
+                });
+            }
+            loader.Poll();
+
+            std::deque<Page*> ready;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                doneCv.wait_for(lock, std::chrono::milliseconds(1), [&] { return !parsed.empty(); });
+                ready.swap(parsed);
+            }
+            // layout needs the single ImGui context, so it stays on this thread
+            for (Page* page : ready) {
+                TRACE_SCOPE_ARG("batch", "layout", page->url.c_str());
+                page->layoutStart = trace::NowUs();
+                fonts.RequestPage(page->root);
+                fonts.Update();
+                ImGui::NewFrame();
+                ImGui::SetNextWindowPos(ImVec2(0, 0));
+                ImGui::SetNextWindowSize(io.DisplaySize);
+                ImGui::Begin("page", nullptr, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoSavedSettings);
+                RenderPage(page->root, hooks);
+                ImGui::End();
+                ImGui::Render();
+
+                char name[32];
+                if (options.dump == BatchDump::Text) {
+                    std::string text;
+                    ExtractText(page->root, text);
+                    snprintf(name, sizeof(name), "/%05zu.txt", page->index);
+                    if (FILE* f = fopen((options.outDir + name).c_str(), "w")) {
+                        fwrite(text.data(), 1, text.size(), f);
+                        fclose(f);
+                    }
+                } else if (options.dump == BatchDump::DisplayList) {
+                    snprintf(name, sizeof(name), "/%05zu.dl", page->index);
+                    if (FILE* f = fopen((options.outDir + name).c_str(), "w")) {
+                        WriteDisplayList(f, *page, ImGui::GetDrawData());
+                        fclose(f);
+                    }
+                }
+                page->root = HTMLNode();
+                page->ok = true;
+                finish(*page);
+            }
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    parseCv.notify_all();
+    for (auto& worker : workers) worker.join();
+    if (index) fclose(index);
+    ImGui::DestroyContext();
+
+    double seconds = (trace::NowUs() - batchStart) / 1e6;
+    std::vector<double> latency, fetch, parseWait, parse, layoutWait, layout;
+    for (const Page& page : pages) {
+        latency.push_back((page.done - page.started) / 1000.0);
+        if (!page.ok) continue;
+        fetch.push_back((page.fetched - page.started) / 1000.0);
+        parseWait.push_back((page.parseStart - page.fetched) / 1000.0);
+        parse.push_back((page.parsed - page.parseStart) / 1000.0);
+        layoutWait.push_back((page.layoutStart - page.parsed) / 1000.0);
+        layout.push_back((page.done - page.layoutStart) / 1000.0);
+    }
+    printf("%zu pages, %d failed, %.2f s, %.1f pages/s (concurrency %d, %d parse threads)\n",
+           pages.size(), failed, seconds, pages.size() / seconds, options.concurrency, parseThreads);
+    printf("latency ms   p50 %8.1f  p90 %8.1f  p99 %8.1f  max %8.1f\n",
+           Percentile(latency, 0.50), Percentile(latency, 0.90), Percentile(latency, 0.99), Percentile(latency, 1.0));
+    printf("stage p50 ms fetch %.1f  parse wait %.1f  parse %.1f  layout wait %.1f  layout+dump %.1f\n",
+           Percentile(fetch, 0.5), Percentile(parseWait, 0.5), Percentile(parse, 0.5),
+           Percentile(layoutWait, 0.5), Percentile(layout, 0.5));
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <string>
+#include "loader.h"
+
+enum class BatchDump { None, Text, DisplayList };
+
+struct BatchOptions {
+    // A file of URLs, one per line ('#' starts a comment), or a recorded
+    // archive, whose HTML responses are replayed as the list.
+    std::string input;
+    NetworkOptions network;
+    int concurrency = 16;   // pages anywhere in the pipeline at once
+    int parseThreads = 0;   // 0: half the cores
+    BatchDump dump = BatchDump::None;
+    std::string outDir = ".";
+    int width = 1280;       // layout viewport
+    int height = 800;
+};
+
+// Runs every page through fetch -> parse -> layout -> dump with bounded
+// concurrency and prints throughput and latency percentiles. Images are not
+// fetched; layout sees their placeholders. Returns a process exit code.
+int RunBatch(const BatchOptions& options);
@@ -0,0 +1,64 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// operator new calls made so far by the whole process (bench_main.cpp
+// replaces it to count them). malloc from C code such as stb_image is not seen.
+size_t AllocationCount();
+
+// Tiny timing harness: runs a body until minSeconds have passed and reports
+// per-iteration cost, heap allocations per iteration and throughput in
+// whatever units the caller supplies.
+struct BenchResult {
+    double seconds = 0;     // total wall time
+    size_t iterations = 0;
+    size_t allocations = 0;
+};
+
+template <typename F>
+BenchResult Measure(F&& body, double minSeconds = 0.5) {
+    using Clock = std::chrono::steady_clock;
+    body();  // warm up caches and lazy init
+    BenchResult result;
+    size_t allocStart = AllocationCount();
+    auto start = Clock::now();
+    do {
+        body();
+        result.iterations++;
+        result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (result.seconds < minSeconds);
+    result.allocations = AllocationCount() - allocStart;
+    return result;
+}
+
+// bytesPerIter / itemsPerIter of 0 leave that column out
+inline void Report(const char* name, const BenchResult& r,
+                   double bytesPerIter, double itemsPerIter = 0, const char* itemUnit = "items") {
+    double perIter = r.seconds / r.iterations;
+    printf("%-40s %10.2f us/op  %9.1f allocs/op", name, perIter * 1e6,
+           static_cast<double>(r.allocations) / r.iterations);
+    if (bytesPerIter > 0) printf("  %9.1f MB/s", bytesPerIter / perIter / 1e6);
+    if (itemsPerIter > 0) printf("  %11.0f %s/s", itemsPerIter / perIter, itemUnit);
+    printf("\n");
+}
+
+// Saved pages and images under bench/corpus (see the README there).
+struct CorpusPage {
+    std::string name;
+    std::string baseUrl;  // the URL the page was saved from
+    std::string html;
+};
+
+void SetCorpusDir(const std::string& dir);
+bool ReadCorpusFile(const std::string& name, std::string& out);
+const std::vector<CorpusPage>& CorpusPages();
+
+void RunBase64Benchmarks();
+void RunParserBenchmarks();
+void RunEncodingBenchmarks();
+void RunURLBenchmarks();
+void RunDecodeBenchmarks();
+void RunDisplayListBenchmarks();
@@ -0,0 +1,51 @@
+#include "bench.h"
+#include "data_uri.h"
+#include <random>
+#include <string>
+
+static std::string Encode(const std::string& bytes, size_t lineLength) {
+    static const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    size_t column = 0;
+    for (size_t i = 0; i < bytes.size(); i += 3) {
+        unsigned v = (unsigned char)bytes[i] << 16;
+        if (i + 1 < bytes.size()) v |= (unsigned char)bytes[i + 1] << 8;
+        if (i + 2 < bytes.size()) v |= (unsigned char)bytes[i + 2];
+        out += alphabet[(v >> 18) & 63];
+        out += alphabet[(v >> 12) & 63];
+        out += i + 1 < bytes.size() ? alphabet[(v >> 6) & 63] : '=';
+        out += i + 2 < bytes.size() ? alphabet[v & 63] : '=';
+        column += 4;
+        if (lineLength && column >= lineLength) {
+            out += "\r\n";
+            column = 0;
+        }
+    }
+    return out;
+}
+
+void RunBase64Benchmarks() {
+    std::mt19937 rng(42);
+    std::string payload(256 * 1024, '\0');
+    for (auto& c : payload) c = static_cast<char>(rng());
+
+    struct Case { const char* name; size_t lineLength; };
+    const Case cases[] = {
+        {"base64 256KiB unwrapped", 0},
+        {"base64 256KiB MIME 76-col", 76},
+    };
+
+    std::string decoded;
+    for (const Case& c : cases) {
+        std::string encoded = Encode(payload, c.lineLength);
+        if (!Base64Decode(encoded, decoded) || decoded != payload) {
+            printf("%s: decode mismatch\n", c.name);
+            continue;
+        }
+        for (bool simd : {false, true}) {
+            BenchResult r = Measure([&] { Base64Decode(encoded, decoded, simd); });
+            std::string name = std::string(c.name) + (simd ? " (simd)" : " (scalar)");
+            Report(name.c_str(), r, static_cast<double>(encoded.size()));
+        }
+    }
+}
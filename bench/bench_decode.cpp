@@ -0,0 +1,21 @@
+#include "bench.h"
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+// Same call the loader's decode workers make for a fully received body.
+void RunDecodeBenchmarks() {
+    stbi_set_flip_vertically_on_load_thread(true);
+    for (const char* file : {"icon_32.png", "banner_640x160.png", "photo_256.png"}) {
+        std::string bytes;
+        if (!ReadCorpusFile(file, bytes)) continue;
+        int width = 0, height = 0, channels = 0;
+        BenchResult r = Measure([&] {
+            unsigned char* pixels = stbi_load_from_memory(
+                reinterpret_cast<const unsigned char*>(bytes.data()), static_cast<int>(bytes.size()),
+                &width, &height, &channels, 4);
+            stbi_image_free(pixels);
+        });
+        std::string name = std::string("decode ") + file;
+        Report(name.c_str(), r, static_cast<double>(bytes.size()), static_cast<double>(width) * height, "px");
+    }
+}
@@ -0,0 +1,70 @@
+#include "bench.h"
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <sstream>
+
+static std::atomic<size_t> g_allocations{0};
+
+void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+size_t AllocationCount() { return g_allocations.load(std::memory_order_relaxed); }
+
+#ifndef BENCH_CORPUS_DIR
+#define BENCH_CORPUS_DIR "bench/corpus"
+#endif
+
+static std::string g_corpusDir = BENCH_CORPUS_DIR;
+
+void SetCorpusDir(const std::string& dir) { g_corpusDir = dir; }
+
+bool ReadCorpusFile(const std::string& name, std::string& out) {
+    std::ifstream file(g_corpusDir + "/" + name, std::ios::binary);
+    if (!file) {
+        fprintf(stderr, "[Bench] Missing corpus file %s/%s\n", g_corpusDir.c_str(), name.c_str());
+        return false;
+    }
+    std::ostringstream buffer;
+    buffer << file.rdbuf();
+    out = buffer.str();
+    return true;
+}
+
+const std::vector<CorpusPage>& CorpusPages() {
+    static const std::vector<CorpusPage> pages = [] {
+        const CorpusPage list[] = {
+            {"blog_post.html", "https://blog.example.com/2024/08/tiny-browser-fast.html", ""},
+            {"hn_front.html", "https://news.ycombinator.com/news", ""},
+            {"wiki_article.html", "https://en.wikipedia.org/wiki/Web_browser", ""},
+            {"forum_thread.html", "https://forum.example.com/t/browser-perf/1234", ""},
+        };
+        std::vector<CorpusPage> loaded;
+        for (const CorpusPage& page : list) {
+            CorpusPage copy = page;
+            if (ReadCorpusFile(page.name, copy.html)) loaded.push_back(std::move(copy));
+        }
+        return loaded;
+    }();
+    return pages;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1) SetCorpusDir(argv[1]);
+    RunEncodingBenchmarks();
+    RunParserBenchmarks();
+    RunURLBenchmarks();
+    RunDecodeBenchmarks();
+    RunDisplayListBenchmarks();
+    RunBase64Benchmarks();
+    return 0;
+}
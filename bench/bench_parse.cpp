@@ -0,0 +1,122 @@
+#include <map>
+#include "bench.h"
+#include "encoding.h"
+#include "flat_map.h"
+#include "html_parser.h"
+#include "url.h"
+
+void RunParserBenchmarks() {
+    for (const CorpusPage& page : CorpusPages()) {
+        HTMLParseStats stats;
+        BenchResult r = Measure([&] { ParseHTML(page.html, &stats); });
+        std::string name = "parse " + page.name;
+        Report(name.c_str(), r, static_cast<double>(page.html.size()), stats.nodes, "nodes");
+    }
+}
+
+// The path every UTF-8 page takes: detect, validate, leave the bytes alone
+void RunEncodingBenchmarks() {
+    for (const CorpusPage& page : CorpusPages()) {
+        std::string html = page.html;
+        BenchResult r = Measure([&] { DecodeToUTF8(html, "text/html; charset=utf-8"); });
+        std::string name = "utf8 " + page.name;
+        Report(name.c_str(), r, static_cast<double>(html.size()));
+    }
+}
+
+static void CollectReferences(const HTMLNode& node, std::vector<std::string>& out) {
+    for (Atom attr : {Atom::Href, Atom::Src}) {
+        if (const HTMLAttribute* found = node.FindAttr(attr)) out.emplace_back(found->value());
+    }
+    for (const HTMLNode& child : node.children) CollectReferences(child, out);
+}
+
+// Checks every case of url_resolution.txt; returns false if any fails.
+static bool CheckURLConformance() {
+    std::string corpus;
+    if (!ReadCorpusFile("url_resolution.txt", corpus)) return false;
+    URL base, resolved;
+    int cases = 0, failures = 0;
+    size_t lineStart = 0;
+    while (lineStart < corpus.size()) {
+        size_t lineEnd = corpus.find('\n', lineStart);
+        if (lineEnd == std::string::npos) lineEnd = corpus.size();
+        std::string_view line(corpus.data() + lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+        if (line.empty() || line[0] == '#') continue;
+        if (line.compare(0, 6, "@base ") == 0) {
+            base.Parse(line.substr(6));
+            continue;
+        }
+        size_t tab = line.find('\t');
+        if (tab == std::string_view::npos) continue;
+        cases++;
+        std::string_view reference = line.substr(0, tab), expected = line.substr(tab + 1);
+        if (!base.Resolve(reference, resolved) || resolved.Spec() != expected) {
+            failures++;
+            printf("url conformance: '%.*s' against %s gave '%s', expected '%.*s'\n", int(reference.size()),
+                   reference.data(), base.Spec().c_str(), resolved.Spec().c_str(), int(expected.size()),
+                   expected.data());
+        }
+    }
+    printf("url conformance: %d of %d cases pass\n", cases - failures, cases);
+    return failures == 0;
+}
+
+void RunURLBenchmarks() {
+    if (!CheckURLConformance()) return;
+    for (const CorpusPage& page : CorpusPages()) {
+        std::vector<std::string> refs;
+        CollectReferences(ParseHTML(page.html), refs);
+        if (refs.empty()) continue;
+        size_t bytes = 0;
+        for (const std::string& ref : refs) bytes += ref.size();
+
+        // what the browser does: parse the page URL once, resolve into one reused URL
+        URL base, resolved;
+        base.Parse(page.baseUrl);
+        BenchResult r = Measure([&] {
+            for (const std::string& ref : refs) base.Resolve(ref, resolved);
+        });
+        std::string name = "resolve " + page.name;
+        Report(name.c_str(), r, static_cast<double>(bytes), static_cast<double>(refs.size()), "URLs");
+
+        r = Measure([&] {
+            for (const std::string& ref : refs) ResolveURL(page.baseUrl, ref);
+        });
+        name = "resolve to string " + page.name;
+        Report(name.c_str(), r, static_cast<double>(bytes), static_cast<double>(refs.size()), "URLs");
+
+        // a cache hit for every resolved reference: by an id looked up once, as
+        // drawing does, the id lookup itself, and by string
+        std::vector<std::string> specs;
+        std::vector<URLId> ids;
+        URLTable urls;
+        FlatMap<int> byId;
+        std::map<std::string, int, std::less<>> byString;
+        for (const std::string& ref : refs) {
+            if (!base.Resolve(ref, resolved)) continue;
+            specs.push_back(resolved.Spec());
+            ids.push_back(urls.Intern(resolved.Spec()));
+            byId[ids.back()] = 1;
+            byString[std::string(URLCacheKey(resolved.Spec()))] = 1;
+        }
+        int hits = 0;
+        r = Measure([&] {
+            for (URLId id : ids) hits += *byId.Find(id);
+        });
+        name = "url cache " + page.name;
+        Report(name.c_str(), r, 0, static_cast<double>(ids.size()), "lookups");
+        r = Measure([&] {
+            for (const std::string& spec : specs) hits += urls.Find(spec) != 0;
+        });
+        name = "url id " + page.name;
+        Report(name.c_str(), r, 0, static_cast<double>(specs.size()), "lookups");
+        r = Measure([&] {
+            for (const std::string& spec : specs) hits += byString.find(URLCacheKey(spec))->second;
+        });
+        name = "url cache by string " + page.name;
+        Report(name.c_str(), r, 0, static_cast<double>(specs.size()), "lookups");
+        if (hits == 0) printf("url cache: no hits\n");
+    }
+}
@@ -0,0 +1,46 @@
+#include "bench.h"
+#include "page_render.h"
+#include "imgui.h"
+
+// Builds one frame of a page into ImGui draw lists with no window or GPU:
+// layout, text shaping and vertex generation, everything short of the draw
+// calls. Images are stand-ins of their eventual size.
+void RunDisplayListBenchmarks() {
+    ImGui::CreateContext();
+    ImGuiIO& io = ImGui::GetIO();
+    io.IniFilename = nullptr;
+    io.DisplaySize = ImVec2(1280, 800);
+    io.DeltaTime = 1.0f / 60.0f;
+    for (int i = 0; i < 4; i++) io.Fonts->AddFontDefault();  // regular, heading, bold, italic
+    unsigned char* pixels = nullptr;
+    int width = 0, height = 0;
+    io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+
+    PageRenderHooks hooks;
+    hooks.findImage = [](const HTMLNode&, PageImage& out) {
+        out.id = 1;
+        out.width = 220;
+        out.height = 160;
+        return true;
+    };
+
+    for (const CorpusPage& page : CorpusPages()) {
+        HTMLParseStats stats;
+        HTMLNode root = ParseHTML(page.html, &stats);
+        int vertices = 0;
+        BenchResult r = Measure([&] {
+            ImGui::NewFrame();
+            ImGui::SetNextWindowPos(ImVec2(0, 0));
+            ImGui::SetNextWindowSize(io.DisplaySize);
+            ImGui::Begin("page", nullptr, ImGuiWindowFlags_NoDecoration);
+            RenderPage(root, hooks);
+            ImGui::End();
+            ImGui::Render();
+            vertices = ImGui::GetDrawData()->TotalVtxCount;
+        });
+        std::string name = "display list " + page.name;
+        Report(name.c_str(), r, 0, stats.nodes, "nodes");
+        printf("%-40s %10d vertices\n", "", vertices);
+    }
+    ImGui::DestroyContext();
+}
@@ -1,53 +1,172 @@
 #include "browser.h"
+#include "data_uri.h"
+#include "encoding.h"
+#include "fonts.h"
+#include "history.h"
+#include "url.h"
+#include "page_render.h"
+#include "trace.h"
 #include "imgui.h"
 #include <curl/curl.h>
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
-#include <GL/glew.h>  
 #include <iostream>
+#include <algorithm>
+#include <thread>
+#include <ctime>
+#include <cctype>
+#include <cfloat>
+#include <cstring>
+
+Browser::Browser(Renderer& renderer, const NetworkOptions& network) : m_renderer(renderer) {
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    int decodeThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) / 2);
+    m_loader = std::make_unique<ResourceLoader>(decodeThreads, network);
+    m_prefetcher = std::make_unique<LinkPrefetcher>(*m_loader);
+}
 
-static size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
-    ((std::string*)userp)->append((char*)contents, size * nmemb);
-    return size * nmemb;
+Browser::~Browser() {
+    m_textures.ForEach([&](URLId, const TextureData& tex) { m_renderer.DestroyTexture(tex.id); });
 }
-Browser::Browser() {
-    curl_global_init(CURL_GLOBAL_DEFAULT);
-    // Initialize with resolved URL
-    std::string initialUrl = ResolveURL("https://news.ycombinator.com", m_urlInput);
-    strncpy(m_urlInput, initialUrl.c_str(), sizeof(m_urlInput));
-    m_history.push_back(initialUrl);
-    m_historyPos = 0;
-    FetchURL(initialUrl, true);
+
+void Browser::Navigate(const std::string& url) {
+    FetchURL(url, true);
 }
 
-void Browser::FetchURL(const std::string& url, bool addToHistory = true) {
-    // Clear old textures
-    for (auto& [key, tex] : m_textures) {
-        glDeleteTextures(1, &tex.id);
+static const char kHistorySearch[] = "about:history?q=";
+
+// Whether URL bar input is an address rather than words to look up in history.
+static bool LooksLikeURL(const char* input) {
+    std::string_view text(input);
+    if (text.empty() || text.find("://") != std::string_view::npos) return true;
+    if (text.compare(0, 6, "about:") == 0 || text.compare(0, 5, "data:") == 0 || text.compare(0, 5, "file:") == 0) {
+        return true;
     }
-    m_textures.clear();
-    std::string resolvedUrl = ResolveURL(m_urlInput, url);
-    
-    CURL* curl = curl_easy_init();
-    if (curl) {
-        curl_easy_setopt(curl, CURLOPT_URL, resolvedUrl.c_str()); // FIXED LINE
-        CURLcode res;
-        std::string readBuffer;
-        
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
-        curl_easy_setopt(curl, CURLOPT_USERAGENT, "SimpleBrowser/1.0");
-        curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-        
-        res = curl_easy_perform(curl);
-        if(res == CURLE_OK) {
-            m_pageContent = readBuffer;
+    if (text.find_first_of(" \t") != std::string_view::npos) return false;
+    return text.find_first_of("./") != std::string_view::npos || text.compare(0, 9, "localhost") == 0;
+}
+
+static std::string URLEncodeQuery(std::string_view text) {
+    static const char hex[] = "0123456789ABCDEF";
+    std::string out;
+    for (unsigned char c : text) {
+        if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+            out += static_cast<char>(c);
+        } else if (c == ' ') {
+            out += '+';
+        } else {
+            out += '%';
+            out += hex[c >> 4];
+            out += hex[c & 15];
+        }
+    }
+    return out;
+}
+
+static std::string URLDecodeQuery(std::string_view text) {
+    std::string out;
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] == '+') {
+            out += ' ';
+        } else if (text[i] == '%' && i + 2 < text.size() && isxdigit(static_cast<unsigned char>(text[i + 1])) &&
+                   isxdigit(static_cast<unsigned char>(text[i + 2]))) {
+            out += static_cast<char>(std::stoi(std::string(text.substr(i + 1, 2)), nullptr, 16));
+            i += 2;
         } else {
-            m_pageContent = "Failed to fetch URL: " + std::string(curl_easy_strerror(res));
+            out += text[i];
         }
-        curl_easy_cleanup(curl);
     }
+    return out;
+}
+
+static std::string EscapeHTML(std::string_view text) {
+    std::string out;
+    for (char c : text) {
+        switch (c) {
+            case '&': out += "&amp;"; break;
+            case '<': out += "&lt;"; break;
+            case '>': out += "&gt;"; break;
+            case '"': out += "&quot;"; break;
+            default: out += c;
+        }
+    }
+    return out;
+}
+
+// Results of a history search as a page, so they are shown, followed and
+// gone back to like any other.
+std::string Browser::HistorySearchPage(const std::string& query) {
+    std::string html = "<html><head><title>History: " + EscapeHTML(query) + "</title></head><body>";
+    html += "<h1>History</h1>";
+    if (!m_visited) {
+        return html + "<p>History is off.</p></body></html>";
+    }
+    int64_t start = trace::NowUs();
+    std::vector<History::Result> results = m_visited->Search(query, 50);
+    double ms = (trace::NowUs() - start) / 1000.0;
+    char summary[128];
+    snprintf(summary, sizeof(summary), "%zu pages match, searched %zu in %.2f ms", results.size(),
+             m_visited->Entries().size(), ms);
+    html += "<p>" + EscapeHTML(query) + ": " + summary + "</p>";
+    for (const History::Result& result : results) {
+        const HistoryEntry& entry = *result.entry;
+        char visited[32] = "";
+        time_t when = static_cast<time_t>(entry.lastVisit);
+        struct tm local;
+        if (localtime_r(&when, &local)) strftime(visited, sizeof(visited), "%Y-%m-%d %H:%M", &local);
+        std::string title = entry.title.empty() ? entry.url : entry.title;
+        html += "<p><a href=\"" + EscapeHTML(entry.url) + "\">" + EscapeHTML(title) + "</a><br>" +
+                EscapeHTML(entry.url) + " - visited " + visited + "</p>";
+    }
+    return html + "</body></html>";
+}
+
+void Browser::FetchURL(const std::string& url, bool addToHistory = true) {
+    TRACE_SCOPE("navigation", "FetchURL");
+    // Abandon whatever the previous navigation still has in flight
+    m_loader->Cancel(m_navToken);
+    m_navToken = MakeCancelToken();
+    ReportPageStats();
+    m_loader->ResetStats();
+    bool internal = url.compare(0, 6, "about:") == 0;
+    std::string resolvedUrl = internal ? url : ResolveURL(m_urlInput, url);
+    m_navId++;
+    m_navStartUs = trace::NowUs();
+    m_load = PageLoadTimings();
+    m_load.url = resolvedUrl;
+    m_load.navigationStart = m_navStartUs;
+
+    std::string prefetched;
+    if (internal) {
+        m_load.ok = resolvedUrl.compare(0, strlen(kHistorySearch), kHistorySearch) == 0;
+        m_load.status = m_load.ok ? 200 : 404;
+        ShowPage(resolvedUrl, m_load.ok ? HistorySearchPage(URLDecodeQuery(resolvedUrl.substr(strlen(kHistorySearch))))
+                                        : "Unknown page: " + resolvedUrl);
+    } else if (m_prefetcher->Take(resolvedUrl, ImGui::GetTime(), prefetched)) {
+        m_loader->LogCacheHit(resolvedUrl, ResourceKind::Document, RequestSource::Prefetch);
+        m_load.ok = true;
+        m_load.status = 200;
+        ShowPage(resolvedUrl, std::move(prefetched));
+    } else {
+        m_loading = true;
+        m_loader->LoadDocument(resolvedUrl, m_navToken, [this, resolvedUrl](Response& response) {
+            m_load.ok = response.ok;
+            m_load.status = response.status;
+            if (response.ok) {
+                std::string html = response.body.TakeString();
+                TextDecodeInfo text = DecodeToUTF8(html, response.contentType);
+                if (text.converted) {
+                    std::cerr << "[Encoding] " << resolvedUrl << ": " << CharsetName(text.charset) << " from "
+                              << text.source << ", " << text.replaced << " invalid sequences replaced" << std::endl;
+                }
+                ShowPage(resolvedUrl, std::move(html));
+            } else {
+                ShowPage(resolvedUrl, "Failed to fetch URL: " + response.error);
+            }
+        });
+        // a prefetch of this URL still in flight now belongs to the page
+        m_prefetcher->Adopt(resolvedUrl);
+    }
+    m_prefetcher->Reset();
+
     if (addToHistory) {
         // Trim future history if we're not at the end
         if (m_historyPos < static_cast<int>(m_history.size()-1)) {
@@ -62,7 +181,41 @@ void Browser::FetchURL(const std::string& url, bool addToHistory = true) {
     m_urlInput[sizeof(m_urlInput)-1] = '\0'; // Ensure null termination
 }
 
+void Browser::ShowPage(const std::string& url, std::string content) {
+    trace::Async("navigation", "navigate", m_navId, m_navStartUs, trace::NowUs() - m_navStartUs, url.c_str());
+    m_firstRenderPending = true;
+    m_loading = false;
+    m_load.documentReady = trace::NowUs();
+    // Clear old textures
+    m_textures.ForEach([&](URLId, const TextureData& tex) { m_renderer.DestroyTexture(tex.id); });
+    m_textures.Clear();
+    m_pageUrls.Clear();
+    m_textureBytes = 0;
+    m_pageUrl = url;
+    m_pageContent = std::move(content);
+    m_pageDirty = true;
+}
+
 void Browser::DrawUI() {
+    TRACE_SCOPE("frame", "DrawUI");
+    m_hud.RecordFrame(ImGui::GetIO().DeltaTime);
+    if (ImGui::IsKeyPressed(ImGuiKey_F12, false)) {
+        m_hud.visible = !m_hud.visible;
+    }
+    if (ImGui::IsKeyPressed(ImGuiKey_F10, false)) {
+        m_network.visible = !m_network.visible;
+    }
+    if (ImGui::IsKeyPressed(ImGuiKey_F9, false)) {
+        std::string path = "wb-trace-" + std::to_string(time(nullptr)) + ".json";
+        if (trace::WriteJSON(path)) {
+            std::cout << "[Trace] Wrote " << path << std::endl;
+        } else {
+            std::cerr << "[Trace] Could not write " << path << std::endl;
+        }
+    }
+    m_loader->Poll();
+    if (m_pageStatsPending && m_loader->Idle()) ReportPageStats();
+
     ImGuiViewport* viewport = ImGui::GetMainViewport();
     
     // Set window to fill entire viewport
@@ -77,6 +230,8 @@ void Browser::DrawUI() {
         ImGuiWindowFlags_NoBringToFrontOnFocus |
         ImGuiWindowFlags_NoNavFocus;
 
+    ImVec2 suggestAt;
+    float suggestWidth = 0;
     ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(4, 8)); // More vertical spacing
     ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(8, 8));
     
@@ -110,19 +265,33 @@ void Browser::DrawUI() {
             // URL input and Go button
             float availableWidth = ImGui::GetContentRegionAvail().x - 50.0f;
             ImGui::PushItemWidth(availableWidth);
-            if (ImGui::InputText("##URL", m_urlInput, IM_ARRAYSIZE(m_urlInput), 
-                               ImGuiInputTextFlags_EnterReturnsTrue)) {
-                FetchURL(m_urlInput);
-            }
+            bool go = ImGui::InputText("##URL", m_urlInput, IM_ARRAYSIZE(m_urlInput),
+                                       ImGuiInputTextFlags_EnterReturnsTrue);
+            // suggestions follow edits, not the address the page put there
+            if (ImGui::IsItemActivated()) m_suggestedFor = m_urlInput;
+            UpdateSuggestions(ImGui::IsItemActive());
+            suggestAt = ImVec2(ImGui::GetItemRectMin().x, ImGui::GetItemRectMax().y);
+            suggestWidth = ImGui::GetItemRectSize().x;
             ImGui::PopItemWidth();
 
             ImGui::SameLine();
-            if (ImGui::Button("Go", ImVec2(50.0f, 0))) {
-                FetchURL(m_urlInput);
+            go |= ImGui::Button("Go", ImVec2(50.0f, 0));
+            if (go && m_suggestOpen && m_suggestSelected >= 0) {
+                m_suggestOpen = false;
+                FetchURL(m_suggestions[m_suggestSelected].url);
+            } else if (go) {
+                m_suggestOpen = false;
+                FetchURL(LooksLikeURL(m_urlInput) ? std::string(m_urlInput)
+                                                  : kHistorySearch + URLEncodeQuery(m_urlInput));
             }
         }
         ImGui::EndGroup();
 
+        m_find.Draw();
+
+        if (m_loading) {
+            ImGui::TextDisabled("Loading...");
+        }
 
         // Content area (fills remaining space)
         ImGui::BeginChild("Content", 
@@ -130,7 +299,21 @@ void Browser::DrawUI() {
                      ImGuiChildFlags_Border, 
                      ImGuiWindowFlags_HorizontalScrollbar);
     
+	    int64_t renderStart = trace::NowUs();
 	    RenderHTMLContent();
+	    m_load.layoutMs = (trace::NowUs() - renderStart) / 1000.0;
+	    m_hud.RecordRender(m_load.layoutMs);
+	    if (m_firstRenderPending) {
+	        m_firstRenderPending = false;
+	        m_load.firstRender = trace::NowUs();
+	        trace::Instant("navigation", "first render", m_pageUrl.c_str());
+	    } else if (!m_load.complete && m_load.firstRender && !m_loading && m_loader->Idle()) {
+	        m_load.complete = trace::NowUs();
+	        m_load.images = static_cast<int>(m_textures.Size());
+	        m_load.imageBytes = m_textureBytes;
+	        trace::Instant("navigation", "load complete", m_pageUrl.c_str());
+	    }
+	    m_prefetcher->EndFrame(ImGui::GetTime());
 	    
 	    ImGui::EndChild();
 
@@ -138,342 +321,236 @@ void Browser::DrawUI() {
     }
     ImGui::End();
     ImGui::PopStyleVar(2);
+
+    if (m_suggestOpen) DrawSuggestions(suggestAt, suggestWidth);
+    DrawPerfHUD();
+    m_network.Draw(m_loader->GetLog());
 }
 
-void Browser::ParseBasicHTML(const std::string& html) {
-    m_domRoot = HTMLNode{"root", "", {}, {}};
-    std::vector<HTMLNode*> stack = {&m_domRoot};
-    size_t pos = 0;
-    
-    while (pos < html.size()) {
-        if (html[pos] == '<') {
-            size_t tag_start = pos + 1;
-            size_t tag_end = html.find('>', tag_start);
-            if (tag_end == std::string::npos) break;
-            
-            std::string tag_content = html.substr(tag_start, tag_end - tag_start);
-            pos = tag_end + 1;
-            
-            if (tag_content[0] == '/') {
-                if (!stack.empty()) stack.pop_back();
-            } 
-            else {
-                bool self_closing = false;
-                if (!tag_content.empty() && tag_content.back() == '/') {
-                    self_closing = true;
-                    tag_content.pop_back();
-                }
+// Runs on the frame a key changes the URL bar; a lookup is a binary search
+// over the mapped key table plus frecency ranking, well under a millisecond
+// with tens of thousands of pages.
+void Browser::UpdateSuggestions(bool urlActive) {
+    if (!urlActive) {
+        if (!m_suggestHovered) m_suggestOpen = false;  // a click on a suggestion is still to come
+        return;
+    }
+    if (!m_visited) return;
+    if (m_suggestedFor != m_urlInput) {
+        TRACE_SCOPE("history", "URL suggestions");
+        int64_t start = trace::NowUs();
+        m_suggestedFor = m_urlInput;
+        m_suggestions.clear();
+        for (const HistoryEntry* entry : m_visited->Suggest(m_urlInput, 8)) {
+            m_suggestions.push_back({entry->url, entry->title});
+        }
+        m_suggestSelected = -1;
+        m_suggestOpen = !m_suggestions.empty();
+        m_suggestMs = (trace::NowUs() - start) / 1000.0;
+    }
+    if (!m_suggestOpen) return;
+    int count = static_cast<int>(m_suggestions.size());
+    if (ImGui::IsKeyPressed(ImGuiKey_DownArrow)) m_suggestSelected = (m_suggestSelected + 1) % count;
+    if (ImGui::IsKeyPressed(ImGuiKey_UpArrow)) m_suggestSelected = (m_suggestSelected < 0 ? count : m_suggestSelected) - 1;
+    if (ImGui::IsKeyPressed(ImGuiKey_Escape, false)) m_suggestOpen = false;
+}
 
-                HTMLNode node;
-                size_t space_pos = tag_content.find(' ');
-                node.tag = tag_content.substr(0, space_pos);
-                
-                // Parse attributes
-                size_t attr_start = space_pos;
-                while (attr_start != std::string::npos) {
-                    attr_start = tag_content.find_first_not_of(' ', attr_start);
-                    if (attr_start == std::string::npos) break;
-                    
-                    size_t eq_pos = tag_content.find('=', attr_start);
-                    if (eq_pos == std::string::npos) break;
-                    
-                    std::string key = tag_content.substr(attr_start, eq_pos - attr_start);
-                    attr_start = eq_pos + 1;
-                    
-                    if (attr_start < tag_content.size() && tag_content[attr_start] == '"') {
-                        size_t value_start = attr_start + 1;
-                        size_t value_end = tag_content.find('"', value_start);
-                        if (value_end != std::string::npos) {
-                            node.attrs[key] = tag_content.substr(value_start, value_end - value_start);
-                            attr_start = value_end + 1;
-                        }
-                    }
-                }
-                
-                stack.back()->children.push_back(node);
-                if (!self_closing) {
-                    stack.push_back(&stack.back()->children.back());
-                }
-            }
-        } 
-        else {
-            size_t text_end = html.find('<', pos);
-            if (text_end == std::string::npos) text_end = html.size();
-            
-            std::string text = html.substr(pos, text_end - pos);
-            text.erase(text.find_last_not_of(" \n\r\t") + 1);
-            text.erase(0, text.find_first_not_of(" \n\r\t"));
-            
-            // PREVENT EMPTY TEXT NODES
-            if (!text.empty()) {
-                stack.back()->children.push_back(HTMLNode{"text", text, {}, {}});
-            }
-            pos = text_end;
+void Browser::DrawSuggestions(const ImVec2& below, float width) {
+    ImGui::SetNextWindowPos(below);
+    ImGui::SetNextWindowSizeConstraints(ImVec2(width, 0), ImVec2(width, FLT_MAX));
+    ImGuiWindowFlags flags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize |
+                             ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoFocusOnAppearing |
+                             ImGuiWindowFlags_NoNav;
+    int chosen = -1;
+    if (ImGui::Begin("##URLSuggestions", nullptr, flags)) {
+        for (int i = 0; i < static_cast<int>(m_suggestions.size()); i++) {
+            const URLSuggestion& suggestion = m_suggestions[i];
+            ImGui::PushID(i);
+            std::string label = suggestion.title.empty() ? suggestion.url : suggestion.title + "  -  " + suggestion.url;
+            if (ImGui::Selectable(label.c_str(), i == m_suggestSelected)) chosen = i;
+            ImGui::PopID();
         }
     }
+    m_suggestHovered = ImGui::IsWindowHovered();
+    ImGui::End();
+    if (chosen >= 0) {
+        m_suggestOpen = false;
+        m_suggestHovered = false;
+        FetchURL(m_suggestions[chosen].url);
+    }
+}
+
+void Browser::DrawPerfHUD() {
+    if (!m_hud.visible) return;
+    const ResourceLoader::Stats& stats = m_loader->GetStats();
+    PerfHUD::PageMetrics page;
+    page.domNodes = m_domStats.nodes;
+    page.domDepth = m_domStats.maxDepth;
+    page.parseMs = m_parseMs;
+    if (m_find.visible) {
+        page.findMatches = static_cast<int>(m_find.MatchCount());
+        page.findMs = m_find.LastSearchMs();
+    }
+    if (m_suggestOpen) {
+        page.suggestions = static_cast<int>(m_suggestions.size());
+        page.suggestMs = m_suggestMs;
+    }
+    page.textures = static_cast<int>(m_textures.Size());
+    page.textureBytes = m_textureBytes;
+    page.pendingRequests = m_loader->PendingRequests();
+    page.decodeBacklog = m_loader->DecodeBacklog();
+    page.imageRequests = stats.requests;
+    page.transfers = stats.transfers;
+    page.coalesced = stats.coalesced;
+    page.cancelled = stats.cancelled;
+    page.loading = m_loading;
+    m_hud.Draw(page);
+}
+
+void Browser::OnFrameRendered(const ImDrawData* drawData) {
+    if (m_hud.visible) m_hud.RecordDrawData(drawData);
+}
+
+void Browser::ParseBasicHTML(const std::string& html) {
+    TRACE_SCOPE("page", "ParseBasicHTML");
+    int64_t parseStart = trace::NowUs();
+    m_domRoot = ParseHTML(html, &m_domStats);
+    m_parseMs = (trace::NowUs() - parseStart) / 1000.0;
+    if (m_fonts) m_fonts->RequestPage(m_domRoot);
+    m_load.parseMs = m_parseMs;
+    m_load.domNodes = m_domStats.nodes;
+    m_load.domDepth = m_domStats.maxDepth;
 }
 
 void Browser::LoadImageTexture(const std::string& url) {
-    if (url.find("://") == std::string::npos) {
+    DataURI inlineImage;
+    bool isData = ParseDataURI(url, inlineImage);
+    if (!isData && url.find("://") == std::string::npos) {
         std::cerr << "[Image] Invalid URL: " << url << std::endl;
         return;
     }
-    if (m_textures.count(url)) return;
-    // Add format check here
-    size_t dot_pos = url.find_last_of(".");
-    if (dot_pos == std::string::npos) return;
-    std::string extension = url.substr(dot_pos + 1);
-    if (extension == "svg" || extension == "gif") {
-        std::cerr << "[Texture] Skipping unsupported format: " << url << std::endl;
+    URLId id = m_pageUrls.Intern(url);
+    if (m_textures.Contains(id)) {
+        m_loader->LogCacheHit(url, ResourceKind::Image, RequestSource::Memory);
         return;
     }
-    CURL* curl = curl_easy_init();
-    if (!curl) return;
-
-    std::string image_data;
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &image_data);
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L); // ADDED REDIRECT FOLLOWING
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 5L);
-
-    CURLcode res = curl_easy_perform(curl);
-    if (res != CURLE_OK) {
-        curl_easy_cleanup(curl);
-        return;
+    // Add format check here
+    if (isData) {
+        if (inlineImage.mediaType == "image/svg+xml" || inlineImage.mediaType == "image/gif") {
+            std::cerr << "[Texture] Skipping unsupported inline format: " << inlineImage.mediaType << std::endl;
+            return;
+        }
+    } else {
+        size_t dot_pos = url.find_last_of(".");
+        if (dot_pos == std::string::npos) return;
+        std::string extension = url.substr(dot_pos + 1);
+        if (extension == "svg" || extension == "gif") {
+            std::cerr << "[Texture] Skipping unsupported format: " << url << std::endl;
+            return;
+        }
     }
 
-    long response_code;
-    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
-    curl_easy_cleanup(curl);
+    m_pageStatsPending = true;
+    m_loader->LoadImage(url, m_navToken, [this, id, url](Response& response) {
+        if (response.ok && !m_textures.Contains(id)) {
+            UploadTexture(id, url, response.image);
+        }
+    });
+}
 
-    if (response_code != 200) {  // ENSURE ONLY 200 OK
-        std::cerr << "[HTTP] Non-200 response: " << response_code << std::endl;
-        return;
-    }
-    if (image_data.empty()) {
-        std::cerr << "[Image] Empty data received for " << url << std::endl;
+void Browser::UploadTexture(URLId id, const std::string& url, const DecodedImage& image) {
+    TRACE_SCOPE_ARG("image", "texture upload", url.c_str());
+    ImTextureID texture = m_renderer.CreateTexture(image.pixels.get(), image.width, image.height);
+    if (!texture) {
+        std::cerr << "[Texture] Upload failed for " << url << std::endl;
         return;
     }
 
-    stbi_set_flip_vertically_on_load(true);
-    int width, height, channels;    
-    unsigned char* data = stbi_load_from_memory(
-        reinterpret_cast<const unsigned char*>(image_data.data()),
-        image_data.size(),
-        &width, &height, &channels,
-        4  // Force 4 channels (RGBA)
-    );
-
-    if (!data) {
-        std::cerr << "[STB] Load failed: " << stbi_failure_reason() 
-                  << " (" << url << ")" << std::endl;
-        return;
-    }
+    m_textures[id] = {texture, image.width, image.height};
+    m_textureBytes += m_renderer.TextureBytes(image.width, image.height);
+    std::cout << "[Texture] Successfully loaded: " << url 
+              << " (" << image.width << "x" << image.height << ")" << std::endl;
+}
 
-    if (width <= 0 || height <= 0) {
-        std::cerr << "[Image] Invalid dimensions: " 
-                  << width << "x" << height << " for " << url << std::endl;
-        stbi_image_free(data);
-        return;
-    }
+void Browser::ReportPageStats() {
+    if (!m_pageStatsPending) return;
+    m_pageStatsPending = false;
+    const ResourceLoader::Stats& stats = m_loader->GetStats();
+    std::cout << "[Loader] " << stats.requests << " image requests, "
+              << stats.transfers << " transfers, "
+              << stats.coalesced << " saved by coalescing, "
+              << stats.inlined << " inline, "
+              << stats.cancelled << " cancelled" << std::endl;
+}
 
-    GLuint texture;
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    
-    // Set texture parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, 
-                GL_RGBA, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    GLenum err = glGetError();
-    if (err != GL_NO_ERROR) {
-        std::cerr << "[OpenGL] Error 0x" << std::hex << err 
-                  << " when creating texture for " << url << std::endl;
-        glDeleteTextures(1, &texture);
-        stbi_image_free(data);
-        return;
+// The first <base href> of a document, which replaces its URL as the base
+// for relative references.
+static const HTMLAttribute* FindBaseHref(const HTMLNode& node) {
+    if (node.tag == Atom::Base) return node.FindAttr(Atom::Href);
+    for (const HTMLNode& child : node.children) {
+        if (const HTMLAttribute* href = FindBaseHref(child)) return href;
     }
+    return nullptr;
+}
 
-    m_textures[url] = {texture, width, height};
-    std::cout << "[Texture] Successfully loaded: " << url 
-              << " (" << width << "x" << height << ")" << std::endl;
-    
-    stbi_image_free(data);
+// A link to a fragment of the page already shown needs no fetch.
+bool Browser::IsSamePageAnchor(const URL& target) const {
+    if (!target.HasFragment()) return false;
+    std::string_view page(m_pageUrl);
+    size_t hash = page.find('#');
+    return target.CacheKey() == page.substr(0, hash);
 }
+
 void Browser::RenderHTMLContent() {
-    static std::string lastContent;
-    
-    if (m_pageContent != lastContent) {
+    TRACE_SCOPE("page", "RenderHTMLContent");
+    if (m_pageDirty) {
         ParseBasicHTML(m_pageContent);
-        lastContent = m_pageContent;
+        m_pageDirty = false;
+        m_find.SetPage(m_domRoot);
+        if (m_visited && m_load.ok && m_load.status < 400) m_visited->AddVisit(m_pageUrl, m_domRoot);
         
-        std::function<void(const HTMLNode&)> preloadImages = [&](const HTMLNode& node) {
-            if (node.tag == "img" && node.attrs.count("src")) {
-                std::string resolved = ResolveURL(m_urlInput, node.attrs.at("src"));
-                if (!resolved.empty()) {
-                    LoadImageTexture(resolved);
-                }
+        m_baseUrl.Parse(m_pageUrl);
+        if (const HTMLAttribute* href = FindBaseHref(m_domRoot)) {
+            if (m_baseUrl.Resolve(href->value(), m_resolved)) std::swap(m_baseUrl, m_resolved);
+        }
+
+        // each src is resolved once here and its URL noted on the node, so
+        // drawing finds the texture without resolving it again
+        m_pageImages.clear();
+        std::function<void(HTMLNode&)> preloadImages = [&](HTMLNode& node) {
+            const HTMLAttribute* src = node.tag == Atom::Img ? node.FindAttr(Atom::Src) : nullptr;
+            if (src && !src->value().empty() && m_baseUrl.Resolve(src->value(), m_resolved)) {
+                m_pageImages.push_back(m_pageUrls.Intern(m_resolved.Spec()));
+                node.resource = static_cast<uint32_t>(m_pageImages.size());
+                LoadImageTexture(m_resolved.Spec());
             }
-            for (const auto& child : node.children) {
+            for (auto& child : node.children) {
                 preloadImages(child);
             }
         };
         preloadImages(m_domRoot);
     }
 
-    std::function<void(const HTMLNode&)> renderNode = [&](const HTMLNode& node) {
-            if (node.tag == "text") {
-                if (!node.text.empty()) {
-                    // Render text nodes inline
-                    ImGui::SameLine(0, 0);
-                    ImGui::TextUnformatted(node.text.c_str());
-                    ImGui::SameLine(0, 0);
-                }
-                return;
-            }
-            else if (node.tag == "p") {
-                ImGui::PushTextWrapPos();
-                bool firstChild = true;
-                for (const auto& child : node.children) {
-                    if (!firstChild) ImGui::SameLine(0, 0);
-                    renderNode(child);
-                    firstChild = false;
-                }
-                ImGui::PopTextWrapPos();
-                ImGui::NewLine();
-            }
-            
-                            
-            else if (node.tag == "h1") {
-                ImGui::PushFont(ImGui::GetIO().Fonts->Fonts[1]);
-                // Render all children (including text nodes)
-                for (const auto& child : node.children) {
-                    renderNode(child);
-                }
-                ImGui::PopFont();
-                ImGui::Separator();
-            }
-            else if (node.tag == "h2") {
-                ImGui::PushFont(ImGui::GetIO().Fonts->Fonts[1]);
-                for (const auto& child : node.children) {
-                    renderNode(child);
-                }
-                ImGui::PopFont();
-            }
-            else if (node.tag == "a" && node.attrs.count("href")) {
-                std::string linkText;
-                for (const auto& child : node.children) {
-                    if (child.tag == "text") {
-                        linkText += child.text;
-                    }
-                }
-                if(!linkText.empty()) {
-                    ImGui::PushID(node.attrs.at("href").c_str()); // Unique ID based on URL
-                    ImGui::PushStyleColor(ImGuiCol_Text, IM_COL32(0, 0, 255, 255));
-                    if (ImGui::Selectable(linkText.c_str())) {
-                        std::string resolved = ResolveURL(m_urlInput, node.attrs.at("href"));
-                        FetchURL(resolved);
-                    }
-                    // Add underline
-                    ImVec2 min = ImGui::GetItemRectMin();
-                    ImVec2 max = ImGui::GetItemRectMax();
-                    ImGui::GetWindowDrawList()->AddLine(
-                        ImVec2(min.x, max.y), 
-                        ImVec2(max.x, max.y), 
-                        IM_COL32(0, 0, 255, 255)
-                    );
-                    ImGui::PopStyleColor();
-                    ImGui::PopID();
-                }
-               
-            }
-            else if (node.tag == "p") {
-                ImGui::PushTextWrapPos();
-                for (const auto& child : node.children) renderNode(child);
-                ImGui::PopTextWrapPos();
-                ImGui::Spacing();
-            }
-           
-            
-                
-            else if (node.tag == "img" && node.attrs.count("src")) {
-                const std::string& src = node.attrs.at("src");
-                if (m_textures.count(src)) {
-                    const TextureData& tex = m_textures[src];
-                    ImGui::Image(
-                        (ImTextureID)(static_cast<uint64_t>(tex.id)),  // Correct cast
-                        ImVec2(tex.width, tex.height),
-                        ImVec2(0,0),
-                        ImVec2(1,1),
-                        ImVec4(1,1,1,1),
-                        ImVec4(0,0,0,0)
-                    );
-                } else {
-                    ImGui::TextColored(ImVec4(1,0,0,1), "[Loading: %s]", src.c_str());
-                }
-            }
-            else if (node.tag == "b" || node.tag == "strong") {
-                ImGui::PushFont(ImGui::GetIO().Fonts->Fonts[2]);
-                for (const auto& child : node.children) renderNode(child);
-                ImGui::PopFont();
-            }
-            else if (node.tag == "i" || node.tag == "em") {
-                ImGui::PushFont(ImGui::GetIO().Fonts->Fonts[3]);
-                for (const auto& child : node.children) renderNode(child);
-                ImGui::PopFont();
-            }
-            else {
-                for (const auto& child : node.children) {
-                    renderNode(child);
-                }
-            }
-        };
-        
-        renderNode(m_domRoot);
-}
-std::string Browser::ResolveURL(const std::string& base, const std::string& relative) {
-    if (relative.empty()) return "";
-    if (relative.find("://") != std::string::npos) return relative;
-
-    // Handle protocol-relative URLs (//example.com)
-    if (relative.substr(0, 2) == "//") {
-        size_t protocol_end = base.find("://");
-        if (protocol_end != std::string::npos) {
-            return base.substr(0, protocol_end + 1) + relative.substr(2);
-        }
-        return "https:" + relative;
-    }
-
-    size_t protocol_pos = base.find("://");
-    if (protocol_pos == std::string::npos) return relative;
-
-    std::string protocol = base.substr(0, protocol_pos + 3);
-    std::string base_path = base.substr(protocol_pos + 3);
-
-    // Handle absolute path references
-    if (relative[0] == '/') {
-        size_t domain_end = base_path.find('/');
-        if (domain_end == std::string::npos) return protocol + base_path + relative;
-        return protocol + base_path.substr(0, domain_end) + relative;
-    }
-
-    // Handle relative paths
-    std::string path = base;
-    size_t last_slash = path.rfind('/');
-    if (last_slash == std::string::npos || last_slash < protocol_pos + 3) {
-        path += "/";
-    } else {
-        path = path.substr(0, last_slash + 1);
-    }
-    
-    return path + relative;
+    PageRenderHooks hooks;
+    hooks.findImage = [this](const HTMLNode& img, PageImage& out) {
+        if (img.resource == 0 || img.resource > m_pageImages.size()) return false;
+        const TextureData* tex = m_textures.Find(m_pageImages[img.resource - 1]);
+        if (!tex) return false;
+        out.id = tex->id;
+        out.width = tex->width;
+        out.height = tex->height;
+        return true;
+    };
+    hooks.onLinkClicked = [this](std::string_view href) {
+        if (!m_baseUrl.Resolve(href, m_resolved) || IsSamePageAnchor(m_resolved)) return;
+        FetchURL(m_resolved.Spec());
+    };
+    hooks.onLinkHovered = [this](std::string_view href) {
+        if (!m_baseUrl.Resolve(href, m_resolved) || IsSamePageAnchor(m_resolved)) return;
+        m_prefetcher->OnHover(m_resolved.Spec(), ImGui::GetTime());
+    };
+    if (m_find.visible) hooks.find = &m_find;
+    RenderPage(m_domRoot, hooks);
 }
 
 void Browser::NavigateBack() {
@@ -1,46 +1,130 @@
 #pragma once
 #include <string>
 #include <vector>
-#include <map>
 #include <functional>
+#include <memory>
 #include "imgui.h"
-#include <GL/glew.h>
+#include "loader.h"
+#include "renderer.h"
+#include "html_parser.h"
+#include "prefetch.h"
+#include "perf_hud.h"
+#include "network_panel.h"
+#include "find_in_page.h"
+#include "flat_map.h"
+#include "url.h"
 
+class FontManager;
+class History;
 
 
+
+// Milestones of the current page load in trace::NowUs() microseconds; zero
+// until reached.
+struct PageLoadTimings {
+    std::string url;
+    bool ok = false;              // the document arrived
+    long status = 0;
+    int64_t navigationStart = 0;
+    int64_t documentReady = 0;    // body received
+    int64_t firstRender = 0;      // parsed and laid out once
+    int64_t complete = 0;         // every image fetched, decoded and uploaded
+    double parseMs = 0;
+    double layoutMs = 0;          // most recent frame's page layout
+    int domNodes = 0;
+    int domDepth = 0;
+    int images = 0;
+    size_t imageBytes = 0;
+};
+
 class Browser {
 public:
-    Browser();
+    // renderer must outlive the browser.
+    explicit Browser(Renderer& renderer, const NetworkOptions& network = NetworkOptions());
+    ~Browser();
+    void Navigate(const std::string& url);
     void DrawUI();
+    // Call after ImGui::Render() so the HUD can show draw statistics.
+    void OnFrameRendered(const ImDrawData* drawData);
+
+    const PageLoadTimings& GetLoadTimings() const { return m_load; }
+    bool PageLoaded() const { return m_load.complete != 0; }
+    const ResourceLoader::Stats& GetLoaderStats() const { return m_loader->GetStats(); }
+    // Parsed pages tell fonts which characters they need; may be null.
+    void SetFontManager(FontManager* fonts) { m_fonts = fonts; }
+    // Pages shown are recorded here and searched from the URL bar; may be null.
+    void SetHistory(History* history) { m_visited = history; }
     
 private:
     void FetchURL(const std::string& url, bool addToHistory);
+    void ShowPage(const std::string& url, std::string content);
     void RenderHTMLContent();
     void ParseBasicHTML(const std::string& html);
     void LoadImageTexture(const std::string& url);
+    void UploadTexture(URLId id, const std::string& url, const DecodedImage& image);
+    void ReportPageStats();
+    std::string HistorySearchPage(const std::string& query);
+    bool IsSamePageAnchor(const URL& target) const;
+    void UpdateSuggestions(bool urlActive);
+    void DrawSuggestions(const ImVec2& below, float width);
     
     char m_urlInput[1024] = "https://news.ycombinator.com";
     std::string m_pageContent;
-    
-    struct HTMLNode {
-        std::string tag;
-        std::string text;
-        std::map<std::string, std::string> attrs;
-        std::vector<HTMLNode> children;
-    };
+    std::string m_pageUrl;      // the shown page
+    URL m_baseUrl;              // its <base href>, or its URL: what links and images resolve against
+    URL m_resolved;             // scratch for resolving references against m_baseUrl
+    bool m_pageDirty = false;   // m_pageContent changed since the last parse
+    bool m_loading = false;
+    uint64_t m_navId = 0;            // trace track of the current navigation
+    int64_t m_navStartUs = 0;
+    bool m_firstRenderPending = false;
     
     HTMLNode m_domRoot;
 	struct TextureData {
-	    GLuint id;
+	    ImTextureID id;
 	    int width;
 	    int height;
 	};
 
-	std::map<std::string, TextureData> m_textures;
+	URLTable m_pageUrls;              // images of the page shown
+	FlatMap<TextureData> m_textures;  // by URLId in m_pageUrls
+	std::vector<URLId> m_pageImages;  // by <img> HTMLNode::resource - 1
 
-    //resolve relative urls
-    std::string ResolveURL(const std::string& base, const std::string& relative);
+    Renderer& m_renderer;
+    FontManager* m_fonts = nullptr;
+    History* m_visited = nullptr;
+    PageLoadTimings m_load;
 
+    // background fetch/decode, shared by all image requests of a page
+    std::unique_ptr<ResourceLoader> m_loader;
+    CancelToken m_navToken;     // cancelled when the user navigates away
+    std::unique_ptr<LinkPrefetcher> m_prefetcher;
+
+    // performance overlay (F12)
+    PerfHUD m_hud;
+    HTMLParseStats m_domStats;
+    double m_parseMs = 0;
+    size_t m_textureBytes = 0;
+    void DrawPerfHUD();
+    bool m_pageStatsPending = false;
+
+    // request waterfall (F10)
+    NetworkPanel m_network;
+
+    // find in page (Ctrl+F)
+    FindInPage m_find;
+
+    // URL bar completions from history
+    struct URLSuggestion {
+        std::string url;
+        std::string title;
+    };
+    std::vector<URLSuggestion> m_suggestions;
+    std::string m_suggestedFor;    // the URL bar text m_suggestions are for
+    int m_suggestSelected = -1;    // -1: Enter goes to what was typed
+    bool m_suggestOpen = false;
+    bool m_suggestHovered = false;
+    double m_suggestMs = 0;
 
     //url history, foward, and back...
     std::vector<std::string> m_history;
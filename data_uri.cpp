@@ -0,0 +1,229 @@
+#include "data_uri.h"
+#include <cstdint>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <tmmintrin.h>
+#define WB_BASE64_SSSE3 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define WB_BASE64_NEON 1
+#endif
+
+static bool StartsWithNoCase(std::string_view s, std::string_view prefix) {
+    if (s.size() < prefix.size()) return false;
+    for (size_t i = 0; i < prefix.size(); i++) {
+        char c = s[i];
+        if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+        if (c != prefix[i]) return false;
+    }
+    return true;
+}
+
+bool IsDataURI(std::string_view uri) {
+    return StartsWithNoCase(uri, "data:");
+}
+
+bool ParseDataURI(std::string_view uri, DataURI& out) {
+    if (!IsDataURI(uri)) return false;
+    size_t comma = uri.find(',');
+    if (comma == std::string_view::npos) return false;
+
+    std::string_view meta = uri.substr(5, comma - 5);
+    out.payload = uri.substr(comma + 1);
+    out.base64 = false;
+    if (meta.size() >= 7 && StartsWithNoCase(meta.substr(meta.size() - 7), ";base64")) {
+        out.base64 = true;
+        meta.remove_suffix(7);
+    }
+    out.mediaType = meta.substr(0, meta.find(';'));
+    return true;
+}
+
+static int HexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool DecodeDataURI(const DataURI& uri, std::string& out) {
+    if (uri.base64) return Base64Decode(uri.payload, out);
+
+    // percent-encoded payload
+    out.clear();
+    out.reserve(uri.payload.size());
+    for (size_t i = 0; i < uri.payload.size(); i++) {
+        char c = uri.payload[i];
+        if (c == '%' && i + 2 < uri.payload.size() &&
+            HexValue(uri.payload[i + 1]) >= 0 && HexValue(uri.payload[i + 2]) >= 0) {
+            out.push_back(static_cast<char>(HexValue(uri.payload[i + 1]) * 16 + HexValue(uri.payload[i + 2])));
+            i += 2;
+        } else {
+            out.push_back(c);
+        }
+    }
+    return true;
+}
+
+// Scalar lookup: 0..63 sextet, or one of the markers below
+static const int8_t kInvalid = -1;
+static const int8_t kSpace = -2;
+static const int8_t kPad = -3;
+
+struct Base64Table {
+    int8_t value[256];
+    Base64Table() {
+        for (int i = 0; i < 256; i++) value[i] = kInvalid;
+        const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        for (int i = 0; i < 64; i++) value[(unsigned char)alphabet[i]] = static_cast<int8_t>(i);
+        value[(unsigned char)' '] = value[(unsigned char)'\t'] = kSpace;
+        value[(unsigned char)'\n'] = value[(unsigned char)'\r'] = value[(unsigned char)'\f'] = kSpace;
+        value[(unsigned char)'='] = kPad;
+    }
+};
+static const Base64Table kTable;
+
+// Vector kernels decode whole blocks until one contains anything outside the
+// alphabet (whitespace, padding, garbage) and return the input consumed; the
+// scalar loop takes over from there. They may write up to 4 bytes past the
+// decoded output, which the caller leaves room for.
+typedef size_t (*Base64Kernel)(const unsigned char* src, size_t len, unsigned char* dst);
+
+#if WB_BASE64_SSSE3
+__attribute__((target("ssse3")))
+static size_t DecodeBlocksSSSE3(const unsigned char* src, size_t len, unsigned char* dst) {
+    size_t used = 0;
+    while (len - used >= 16) {
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + used));
+
+        // classify with signed compares; bytes >= 0x80 fall outside every range
+        __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(in, _mm_set1_epi8('A' - 1)),
+                                      _mm_cmplt_epi8(in, _mm_set1_epi8('Z' + 1)));
+        __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(in, _mm_set1_epi8('a' - 1)),
+                                      _mm_cmplt_epi8(in, _mm_set1_epi8('z' + 1)));
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(in, _mm_set1_epi8('0' - 1)),
+                                      _mm_cmplt_epi8(in, _mm_set1_epi8('9' + 1)));
+        __m128i plus = _mm_cmpeq_epi8(in, _mm_set1_epi8('+'));
+        __m128i slash = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+        __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower),
+                                     _mm_or_si128(digit, _mm_or_si128(plus, slash)));
+        if (_mm_movemask_epi8(valid) != 0xFFFF) break;
+
+        __m128i shift = _mm_and_si128(upper, _mm_set1_epi8(-65));
+        shift = _mm_or_si128(shift, _mm_and_si128(lower, _mm_set1_epi8(-71)));
+        shift = _mm_or_si128(shift, _mm_and_si128(digit, _mm_set1_epi8(4)));
+        shift = _mm_or_si128(shift, _mm_and_si128(plus, _mm_set1_epi8(62 - '+')));
+        shift = _mm_or_si128(shift, _mm_and_si128(slash, _mm_set1_epi8(63 - '/')));
+        __m128i values = _mm_add_epi8(in, shift);
+
+        // [a b c d] sextets -> 24 bits per 32-bit lane, then gather 12 bytes
+        __m128i pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+        __m128i quads = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+        __m128i bytes = _mm_shuffle_epi8(quads, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), bytes);
+
+        dst += 12;
+        used += 16;
+    }
+    return used;
+}
+
+static Base64Kernel SelectKernel() {
+    static const Base64Kernel kernel = __builtin_cpu_supports("ssse3") ? DecodeBlocksSSSE3 : nullptr;
+    return kernel;
+}
+#elif WB_BASE64_NEON
+static inline uint8x16_t Sextets(uint8x16_t c, uint8x16_t& valid) {
+    uint8x16_t upper = vandq_u8(vcgeq_u8(c, vdupq_n_u8('A')), vcleq_u8(c, vdupq_n_u8('Z')));
+    uint8x16_t lower = vandq_u8(vcgeq_u8(c, vdupq_n_u8('a')), vcleq_u8(c, vdupq_n_u8('z')));
+    uint8x16_t digit = vandq_u8(vcgeq_u8(c, vdupq_n_u8('0')), vcleq_u8(c, vdupq_n_u8('9')));
+    uint8x16_t plus = vceqq_u8(c, vdupq_n_u8('+'));
+    uint8x16_t slash = vceqq_u8(c, vdupq_n_u8('/'));
+    valid = vandq_u8(valid, vorrq_u8(vorrq_u8(upper, lower), vorrq_u8(digit, vorrq_u8(plus, slash))));
+
+    uint8x16_t shift = vandq_u8(upper, vdupq_n_u8(static_cast<uint8_t>(-65)));
+    shift = vorrq_u8(shift, vandq_u8(lower, vdupq_n_u8(static_cast<uint8_t>(-71))));
+    shift = vorrq_u8(shift, vandq_u8(digit, vdupq_n_u8(4)));
+    shift = vorrq_u8(shift, vandq_u8(plus, vdupq_n_u8(62 - '+')));
+    shift = vorrq_u8(shift, vandq_u8(slash, vdupq_n_u8(63 - '/')));
+    return vaddq_u8(c, shift);
+}
+
+static size_t DecodeBlocksNEON(const unsigned char* src, size_t len, unsigned char* dst) {
+    size_t used = 0;
+    while (len - used >= 64) {
+        // de-interleave so each register holds one position of 16 quads
+        uint8x16x4_t in = vld4q_u8(src + used);
+        uint8x16_t valid = vdupq_n_u8(0xFF);
+        uint8x16_t a = Sextets(in.val[0], valid);
+        uint8x16_t b = Sextets(in.val[1], valid);
+        uint8x16_t c = Sextets(in.val[2], valid);
+        uint8x16_t d = Sextets(in.val[3], valid);
+        if (vminvq_u8(valid) == 0) break;
+
+        uint8x16x3_t out;
+        out.val[0] = vorrq_u8(vshlq_n_u8(a, 2), vshrq_n_u8(b, 4));
+        out.val[1] = vorrq_u8(vshlq_n_u8(b, 4), vshrq_n_u8(c, 2));
+        out.val[2] = vorrq_u8(vshlq_n_u8(c, 6), d);
+        vst3q_u8(dst, out);
+
+        dst += 48;
+        used += 64;
+    }
+    return used;
+}
+
+static Base64Kernel SelectKernel() { return DecodeBlocksNEON; }
+#else
+static Base64Kernel SelectKernel() { return nullptr; }
+#endif
+
+bool Base64Decode(std::string_view in, std::string& out, bool allowSimd) {
+    const unsigned char* src = reinterpret_cast<const unsigned char*>(in.data());
+    size_t len = in.size();
+    out.resize(len / 4 * 3 + 3 + 16);  // slack for the vector stores
+    unsigned char* dst = reinterpret_cast<unsigned char*>(&out[0]);
+
+    Base64Kernel kernel = allowSimd ? SelectKernel() : nullptr;
+    size_t i = 0, o = 0;
+    uint32_t acc = 0;
+    int n = 0;     // sextets in acc
+    int pad = 0;   // '=' seen
+
+    while (i < len) {
+        if (kernel && n == 0 && pad == 0) {
+            size_t used = kernel(src + i, len - i, dst + o);
+            i += used;
+            o += used / 4 * 3;
+            if (i >= len) break;
+        }
+        int8_t v = kTable.value[src[i++]];
+        if (v >= 0) {
+            if (pad) return false;  // data after padding
+            acc = (acc << 6) | static_cast<uint32_t>(v);
+            if (++n == 4) {
+                dst[o++] = static_cast<unsigned char>(acc >> 16);
+                dst[o++] = static_cast<unsigned char>(acc >> 8);
+                dst[o++] = static_cast<unsigned char>(acc);
+                acc = 0;
+                n = 0;
+            }
+        } else if (v == kPad) {
+            if (++pad > 2) return false;
+        } else if (v != kSpace) {
+            return false;
+        }
+    }
+
+    if (pad && n + pad != 4) return false;
+    if (n == 1) return false;
+    if (n == 2) {
+        dst[o++] = static_cast<unsigned char>(acc >> 4);
+    } else if (n == 3) {
+        dst[o++] = static_cast<unsigned char>(acc >> 10);
+        dst[o++] = static_cast<unsigned char>(acc >> 2);
+    }
+    out.resize(o);
+    return true;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+// Parsed form of a data: URI (RFC 2397). payload points into the input.
+struct DataURI {
+    std::string_view mediaType;  // e.g. "image/png"; empty means text/plain
+    bool base64 = false;
+    std::string_view payload;
+};
+
+bool IsDataURI(std::string_view uri);
+bool ParseDataURI(std::string_view uri, DataURI& out);
+
+// Decodes the payload of a data URI into raw bytes.
+bool DecodeDataURI(const DataURI& uri, std::string& out);
+
+// Standard base64 (RFC 4648) decode. ASCII whitespace is skipped and trailing
+// padding is optional. Long runs go through a vectorized kernel when the CPU
+// has one (SSSE3 or NEON); allowSimd=false forces the scalar path.
+bool Base64Decode(std::string_view in, std::string& out, bool allowSimd = true);
@@ -0,0 +1,556 @@
+#include "encoding.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include "simd.h"
+
+#if defined(SB_SIMD_SSE2)
+#include <tmmintrin.h>
+#endif
+
+namespace {
+
+constexpr uint16_t kSingleByte[][128] = {
+#include "charset_tables.inc"
+};
+constexpr size_t kSingleByteCount = sizeof(kSingleByte) / sizeof(kSingleByte[0]);
+static_assert(kSingleByteCount == static_cast<size_t>(Charset::KOI8R) - static_cast<size_t>(Charset::Windows1252) + 1,
+              "one table per single-byte charset");
+
+// The upper half of each table pre-encoded: up to three UTF-8 bytes and
+// their count, so converting a byte is one load and one store.
+struct Encoded {
+    char bytes[4];
+};
+
+constexpr Encoded EncodeBMP(uint16_t c) {
+    Encoded e = {};
+    if (c < 0x800) {
+        e.bytes[0] = static_cast<char>(0xC0 | (c >> 6));
+        e.bytes[1] = static_cast<char>(0x80 | (c & 0x3F));
+        e.bytes[3] = 2;
+    } else {
+        e.bytes[0] = static_cast<char>(0xE0 | (c >> 12));
+        e.bytes[1] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        e.bytes[2] = static_cast<char>(0x80 | (c & 0x3F));
+        e.bytes[3] = 3;
+    }
+    return e;
+}
+
+struct EncodedTables {
+    Encoded tables[kSingleByteCount][128] = {};
+};
+
+constexpr EncodedTables BuildEncoded() {
+    EncodedTables t;
+    for (size_t i = 0; i < kSingleByteCount; i++) {
+        for (size_t b = 0; b < 128; b++) t.tables[i][b] = EncodeBMP(kSingleByte[i][b]);
+    }
+    return t;
+}
+
+constexpr EncodedTables kEncoded = BuildEncoded();
+
+struct Label {
+    const char* name;
+    Charset charset;
+};
+
+// The WHATWG labels of the charsets above that pages actually use
+const Label kLabels[] = {
+    {"utf-8", Charset::UTF8}, {"utf8", Charset::UTF8}, {"unicode-1-1-utf-8", Charset::UTF8},
+    // a <meta> claiming UTF-16 is wrong by construction; the spec reads it as UTF-8
+    {"utf-16", Charset::UTF8}, {"utf-16le", Charset::UTF8}, {"utf-16be", Charset::UTF8},
+    {"windows-1252", Charset::Windows1252}, {"cp1252", Charset::Windows1252}, {"x-cp1252", Charset::Windows1252},
+    {"iso-8859-1", Charset::Windows1252}, {"iso8859-1", Charset::Windows1252}, {"iso_8859-1", Charset::Windows1252},
+    {"latin1", Charset::Windows1252}, {"l1", Charset::Windows1252}, {"us-ascii", Charset::Windows1252},
+    {"ascii", Charset::Windows1252}, {"cp819", Charset::Windows1252}, {"ibm819", Charset::Windows1252},
+    {"windows-1250", Charset::Windows1250}, {"cp1250", Charset::Windows1250}, {"x-cp1250", Charset::Windows1250},
+    {"windows-1251", Charset::Windows1251}, {"cp1251", Charset::Windows1251}, {"x-cp1251", Charset::Windows1251},
+    {"iso-8859-2", Charset::ISO8859_2}, {"iso8859-2", Charset::ISO8859_2}, {"iso_8859-2", Charset::ISO8859_2},
+    {"latin2", Charset::ISO8859_2}, {"l2", Charset::ISO8859_2},
+    {"iso-8859-15", Charset::ISO8859_15}, {"iso8859-15", Charset::ISO8859_15}, {"iso_8859-15", Charset::ISO8859_15},
+    {"latin-9", Charset::ISO8859_15}, {"l9", Charset::ISO8859_15},
+    {"koi8-r", Charset::KOI8R}, {"koi8", Charset::KOI8R}, {"koi", Charset::KOI8R}, {"cskoi8r", Charset::KOI8R},
+};
+
+char Lower(char c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c + 32) : c;
+}
+
+bool IsSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+// Position just past the first case-insensitive match of needle (lowercase)
+// in [p, end), or nullptr.
+const char* FindAfter(const char* p, const char* end, const char* needle) {
+    size_t n = strlen(needle);
+    for (; end - p >= static_cast<ptrdiff_t>(n); p++) {
+        size_t i = 0;
+        while (i < n && Lower(p[i]) == needle[i]) i++;
+        if (i == n) return p + n;
+    }
+    return nullptr;
+}
+
+// Reads "charset=label" starting right after the word charset.
+bool ParseCharsetValue(const char* p, const char* end, Charset& charset) {
+    while (p < end && IsSpace(*p)) p++;
+    if (p == end || *p != '=') return false;
+    p++;
+    while (p < end && IsSpace(*p)) p++;
+    if (p < end && (*p == '"' || *p == '\'')) p++;
+    const char* start = p;
+    while (p < end && !IsSpace(*p) && *p != '"' && *p != '\'' && *p != ';' && *p != '>') p++;
+    return CharsetFromLabel(std::string_view(start, p - start), charset);
+}
+
+// Covers both <meta charset="..."> and <meta http-equiv content="...; charset=...">.
+bool CharsetFromMeta(const std::string& body, Charset& charset) {
+    const char* p = body.data();
+    const char* end = p + std::min<size_t>(body.size(), 1024);
+    while ((p = FindAfter(p, end, "<meta"))) {
+        const char* close = static_cast<const char*>(memchr(p, '>', end - p));
+        const char* tagEnd = close ? close : end;
+        for (const char* q = p; (q = FindAfter(q, tagEnd, "charset"));) {
+            if (ParseCharsetValue(q, tagEnd, charset)) return true;
+        }
+        p = tagEnd;
+    }
+    return false;
+}
+
+// Length of the well-formed sequence at s, or 0 with bad set to how many
+// bytes one U+FFFD replaces (the maximal subpart, as the Unicode standard
+// and the WHATWG decoder count it).
+size_t Sequence(const unsigned char* s, size_t n, size_t& bad) {
+    unsigned char c = s[0];
+    if (c < 0x80) return 1;
+    size_t need;
+    unsigned char lo = 0x80, hi = 0xBF;
+    if (c >= 0xC2 && c <= 0xDF) {
+        need = 1;
+    } else if (c >= 0xE0 && c <= 0xEF) {
+        need = 2;
+        if (c == 0xE0) lo = 0xA0;
+        if (c == 0xED) hi = 0x9F;  // surrogates
+    } else if (c >= 0xF0 && c <= 0xF4) {
+        need = 3;
+        if (c == 0xF0) lo = 0x90;
+        if (c == 0xF4) hi = 0x8F;  // past U+10FFFF
+    } else {
+        bad = 1;
+        return 0;
+    }
+    for (size_t k = 1; k <= need; k++) {
+        if (k >= n || s[k] < lo || s[k] > hi) {
+            bad = k;
+            return 0;
+        }
+        lo = 0x80;
+        hi = 0xBF;
+    }
+    return need + 1;
+}
+
+bool ValidScalar(const char* data, size_t size) {
+    const char* end = data + size;
+    const char* p = data;
+    while ((p = FindNonASCII(p, end)) < end) {
+        size_t bad;
+        size_t n = Sequence(reinterpret_cast<const unsigned char*>(p), end - p, bad);
+        if (!n) return false;
+        p += n;
+    }
+    return true;
+}
+
+// Lookup-table UTF-8 validation (Keiser and Lemire, "Validating UTF-8 In Less
+// Than One Instruction Per Byte"). Every error shows up in the first twelve
+// bits of some pair of adjacent bytes; three 16-entry tables indexed by those
+// nibbles each flag the errors the nibble allows, and a byte pair is bad if
+// all three agree. Continuation bytes expected by 3- and 4-byte leads are
+// checked separately, and so is a sequence cut off at the end of the input.
+constexpr uint8_t kTooShort = 1 << 0;
+constexpr uint8_t kTooLong = 1 << 1;
+constexpr uint8_t kOverlong3 = 1 << 2;
+constexpr uint8_t kTooLarge = 1 << 3;
+constexpr uint8_t kSurrogate = 1 << 4;
+constexpr uint8_t kOverlong2 = 1 << 5;
+constexpr uint8_t kTooLarge1000 = 1 << 6;
+constexpr uint8_t kOverlong4 = 1 << 6;
+constexpr uint8_t kTwoConts = 1 << 7;
+constexpr uint8_t kCarry = kTooShort | kTooLong | kTwoConts;
+
+alignas(16) constexpr uint8_t kByte1High[16] = {
+    kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong,
+    kTwoConts, kTwoConts, kTwoConts, kTwoConts,
+    kTooShort | kOverlong2,
+    kTooShort,
+    kTooShort | kOverlong3 | kSurrogate,
+    kTooShort | kTooLarge | kTooLarge1000 | kOverlong4,
+};
+alignas(16) constexpr uint8_t kByte1Low[16] = {
+    kCarry | kOverlong3 | kOverlong2 | kOverlong4,
+    kCarry | kOverlong2,
+    kCarry,
+    kCarry,
+    kCarry | kTooLarge,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000 | kSurrogate,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+};
+alignas(16) constexpr uint8_t kByte2High[16] = {
+    kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort,
+    kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge1000 | kOverlong4,
+    kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge,
+    kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+    kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+    kTooShort, kTooShort, kTooShort, kTooShort,
+};
+// a lead byte in the last three positions still owes continuation bytes
+alignas(16) constexpr uint8_t kIncomplete[16] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1,
+};
+
+#if defined(SB_SIMD_SSE2)
+#define SB_UTF8_VECTOR 1
+
+struct VectorState {
+    __m128i error;
+    __m128i prev;
+    __m128i prevIncomplete;
+};
+
+__attribute__((target("ssse3"))) inline void Step(VectorState& st, __m128i input) {
+    if (_mm_movemask_epi8(input) == 0) {
+        st.error = _mm_or_si128(st.error, st.prevIncomplete);
+        st.prev = input;
+        return;
+    }
+    const __m128i low = _mm_set1_epi8(0x0F);
+    const __m128i byte1High = _mm_load_si128(reinterpret_cast<const __m128i*>(kByte1High));
+    const __m128i byte1Low = _mm_load_si128(reinterpret_cast<const __m128i*>(kByte1Low));
+    const __m128i byte2High = _mm_load_si128(reinterpret_cast<const __m128i*>(kByte2High));
+    __m128i prev1 = _mm_alignr_epi8(input, st.prev, 15);
+    __m128i special = _mm_and_si128(
+        _mm_and_si128(_mm_shuffle_epi8(byte1High, _mm_and_si128(_mm_srli_epi16(prev1, 4), low)),
+                      _mm_shuffle_epi8(byte1Low, _mm_and_si128(prev1, low))),
+        _mm_shuffle_epi8(byte2High, _mm_and_si128(_mm_srli_epi16(input, 4), low)));
+    __m128i third = _mm_subs_epu8(_mm_alignr_epi8(input, st.prev, 14), _mm_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+    __m128i fourth = _mm_subs_epu8(_mm_alignr_epi8(input, st.prev, 13), _mm_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+    __m128i must23 = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8(static_cast<char>(0x80)));
+    st.error = _mm_or_si128(st.error, _mm_xor_si128(must23, special));
+    st.prevIncomplete = _mm_subs_epu8(input, _mm_load_si128(reinterpret_cast<const __m128i*>(kIncomplete)));
+    st.prev = input;
+}
+
+__attribute__((target("ssse3"))) bool ValidVector(const char* data, size_t size) {
+    VectorState st = {_mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128()};
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) Step(st, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)));
+    if (i < size) {
+        alignas(16) char tail[16] = {};
+        memcpy(tail, data + i, size - i);
+        Step(st, _mm_load_si128(reinterpret_cast<const __m128i*>(tail)));
+    }
+    __m128i error = _mm_or_si128(st.error, st.prevIncomplete);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xFFFF;
+}
+
+bool HasVector() {
+#if defined(__SSSE3__)
+    return true;
+#else
+    static const bool supported = __builtin_cpu_supports("ssse3");
+    return supported;
+#endif
+}
+
+#elif defined(SB_SIMD_NEON) && defined(__aarch64__)
+#define SB_UTF8_VECTOR 1
+
+bool ValidVector(const char* data, size_t size) {
+    const uint8x16_t low = vdupq_n_u8(0x0F);
+    const uint8x16_t byte1High = vld1q_u8(kByte1High);
+    const uint8x16_t byte1Low = vld1q_u8(kByte1Low);
+    const uint8x16_t byte2High = vld1q_u8(kByte2High);
+    const uint8x16_t incomplete = vld1q_u8(kIncomplete);
+    uint8x16_t error = vdupq_n_u8(0);
+    uint8x16_t prev = vdupq_n_u8(0);
+    uint8x16_t prevIncomplete = vdupq_n_u8(0);
+
+    auto step = [&](uint8x16_t input) {
+        if (vmaxvq_u8(input) < 0x80) {
+            error = vorrq_u8(error, prevIncomplete);
+        } else {
+            uint8x16_t prev1 = vextq_u8(prev, input, 15);
+            uint8x16_t special = vandq_u8(vandq_u8(vqtbl1q_u8(byte1High, vshrq_n_u8(prev1, 4)),
+                                                   vqtbl1q_u8(byte1Low, vandq_u8(prev1, low))),
+                                          vqtbl1q_u8(byte2High, vshrq_n_u8(input, 4)));
+            uint8x16_t third = vqsubq_u8(vextq_u8(prev, input, 14), vdupq_n_u8(0xE0 - 0x80));
+            uint8x16_t fourth = vqsubq_u8(vextq_u8(prev, input, 13), vdupq_n_u8(0xF0 - 0x80));
+            uint8x16_t must23 = vandq_u8(vorrq_u8(third, fourth), vdupq_n_u8(0x80));
+            error = vorrq_u8(error, veorq_u8(must23, special));
+            prevIncomplete = vqsubq_u8(input, incomplete);
+        }
+        prev = input;
+    };
+
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) step(vld1q_u8(reinterpret_cast<const uint8_t*>(data + i)));
+    if (i < size) {
+        uint8_t tail[16] = {};
+        memcpy(tail, data + i, size - i);
+        step(vld1q_u8(tail));
+    }
+    error = vorrq_u8(error, prevIncomplete);
+    return vmaxvq_u8(error) == 0;
+}
+
+bool HasVector() {
+    return true;
+}
+#endif
+
+// Rewrites broken UTF-8 with one U+FFFD per maximal subpart.
+size_t RepairUTF8(std::string& body) {
+    std::string out;
+    out.reserve(body.size() + body.size() / 8);
+    const char* p = body.data();
+    const char* end = p + body.size();
+    size_t replaced = 0;
+    while (p < end) {
+        const char* run = FindNonASCII(p, end);
+        out.append(p, run);
+        p = run;
+        if (p == end) break;
+        size_t bad = 0;
+        size_t n = Sequence(reinterpret_cast<const unsigned char*>(p), end - p, bad);
+        if (n) {
+            out.append(p, n);
+            p += n;
+        } else {
+            out += "\xEF\xBF\xBD";
+            p += bad;
+            replaced++;
+        }
+    }
+    body.swap(out);
+    return replaced;
+}
+
+// Single-byte charset to UTF-8. One pass sizes the output so the second can
+// write it without growing; ASCII runs are found 16 bytes at a time and
+// copied whole. Returns false, touching nothing, if there is nothing but ASCII.
+bool TranscodeSingleByte(std::string& body, Charset charset) {
+    const Encoded* table = kEncoded.tables[static_cast<size_t>(charset) - static_cast<size_t>(Charset::Windows1252)];
+    const char* begin = body.data();
+    const char* end = begin + body.size();
+
+    size_t outSize = body.size();
+    for (const char* p = begin; (p = FindNonASCII(p, end)) < end; p++) {
+        outSize += table[static_cast<unsigned char>(*p) - 0x80].bytes[3] - 1;
+    }
+    if (outSize == body.size()) return false;
+
+    std::string out(outSize + 3, '\0');  // slack for the 4-byte table stores
+    char* w = &out[0];
+    for (const char* p = begin; p < end;) {
+        const char* run = FindNonASCII(p, end);
+        memcpy(w, p, run - p);
+        w += run - p;
+        p = run;
+        for (; p < end && static_cast<unsigned char>(*p) >= 0x80; p++) {
+            const Encoded& e = table[static_cast<unsigned char>(*p) - 0x80];
+            memcpy(w, e.bytes, 4);
+            w += e.bytes[3];
+        }
+    }
+    out.resize(outSize);
+    body.swap(out);
+    return true;
+}
+
+size_t AppendUTF8(uint32_t c, char* out) {
+    if (c < 0x80) {
+        out[0] = static_cast<char>(c);
+        return 1;
+    }
+    if (c < 0x10000) {
+        Encoded e = EncodeBMP(static_cast<uint16_t>(c));
+        memcpy(out, e.bytes, 3);
+        return e.bytes[3];
+    }
+    out[0] = static_cast<char>(0xF0 | (c >> 18));
+    out[1] = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+    out[2] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+    out[3] = static_cast<char>(0x80 | (c & 0x3F));
+    return 4;
+}
+
+// UTF-16 after its BOM; unpaired surrogates and an odd last byte become U+FFFD.
+size_t TranscodeUTF16(std::string& body, bool bigEndian) {
+    const unsigned char* s = reinterpret_cast<const unsigned char*>(body.data());
+    size_t units = body.size() / 2;
+    auto unit = [&](size_t i) -> uint32_t {
+        return bigEndian ? (s[2 * i] << 8 | s[2 * i + 1]) : (s[2 * i + 1] << 8 | s[2 * i]);
+    };
+    std::string out(units * 3 + 3, '\0');
+    char* w = &out[0];
+    size_t replaced = 0;
+    for (size_t i = 0; i < units; i++) {
+        uint32_t c = unit(i);
+        if (c >= 0xD800 && c <= 0xDBFF && i + 1 < units && unit(i + 1) >= 0xDC00 && unit(i + 1) <= 0xDFFF) {
+            c = 0x10000 + ((c - 0xD800) << 10) + (unit(++i) - 0xDC00);
+        } else if (c >= 0xD800 && c <= 0xDFFF) {
+            c = 0xFFFD;
+            replaced++;
+        }
+        w += AppendUTF8(c, w);
+    }
+    if (body.size() % 2) {
+        w += AppendUTF8(0xFFFD, w);
+        replaced++;
+    }
+    out.resize(w - out.data());
+    body.swap(out);
+    return replaced;
+}
+
+}  // namespace
+
+const char* CharsetName(Charset charset) {
+    switch (charset) {
+        case Charset::UTF8: return "utf-8";
+        case Charset::Windows1252: return "windows-1252";
+        case Charset::Windows1250: return "windows-1250";
+        case Charset::Windows1251: return "windows-1251";
+        case Charset::ISO8859_2: return "iso-8859-2";
+        case Charset::ISO8859_15: return "iso-8859-15";
+        case Charset::KOI8R: return "koi8-r";
+        case Charset::UTF16LE: return "utf-16le";
+        case Charset::UTF16BE: return "utf-16be";
+    }
+    return "?";
+}
+
+bool CharsetFromLabel(std::string_view label, Charset& charset) {
+    while (!label.empty() && IsSpace(label.front())) label.remove_prefix(1);
+    while (!label.empty() && IsSpace(label.back())) label.remove_suffix(1);
+    for (const Label& known : kLabels) {
+        size_t i = 0;
+        while (i < label.size() && known.name[i] && Lower(label[i]) == known.name[i]) i++;
+        if (i == label.size() && known.name[i] == '\0') {
+            charset = known.charset;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool IsValidUTF8(const char* data, size_t size) {
+    const char* end = data + size;
+    const char* first = FindNonASCII(data, end);
+    if (first == end) return true;
+#if defined(SB_UTF8_VECTOR)
+    if (HasVector()) return ValidVector(first, end - first);
+#endif
+    return ValidScalar(first, end - first);
+}
+
+TextDecodeInfo DecodeToUTF8(std::string& body, std::string_view contentType) {
+    TextDecodeInfo info;
+    const unsigned char* b = reinterpret_cast<const unsigned char*>(body.data());
+    size_t bom = 0;
+    bool sniffed = false;
+    if (body.size() >= 3 && b[0] == 0xEF && b[1] == 0xBB && b[2] == 0xBF) {
+        info.charset = Charset::UTF8;
+        bom = 3;
+    } else if (body.size() >= 2 && b[0] == 0xFF && b[1] == 0xFE) {
+        info.charset = Charset::UTF16LE;
+        bom = 2;
+    } else if (body.size() >= 2 && b[0] == 0xFE && b[1] == 0xFF) {
+        info.charset = Charset::UTF16BE;
+        bom = 2;
+    }
+
+    if (bom) {
+        info.source = "bom";
+        body.erase(0, bom);
+    } else {
+        const char* end = contentType.data() + contentType.size();
+        const char* param = FindAfter(contentType.data(), end, "charset");
+        if (param && ParseCharsetValue(param, end, info.charset)) {
+            info.source = "header";
+        } else if (CharsetFromMeta(body, info.charset)) {
+            info.source = "meta";
+        } else {
+            info.charset = IsValidUTF8(body.data(), body.size()) ? Charset::UTF8 : Charset::Windows1252;
+            sniffed = true;
+        }
+    }
+
+    switch (info.charset) {
+        case Charset::UTF8:
+            if (!sniffed && !IsValidUTF8(body.data(), body.size())) {
+                info.replaced = RepairUTF8(body);
+                info.converted = true;
+            }
+            break;
+        case Charset::UTF16LE:
+        case Charset::UTF16BE:
+            info.replaced = TranscodeUTF16(body, info.charset == Charset::UTF16BE);
+            info.converted = true;
+            break;
+        default:
+            info.converted = TranscodeSingleByte(body, info.charset);
+            break;
+    }
+    return info;
+}
+
+void FoldCase(const char* in, size_t size, char* out) {
+    const unsigned char* s = reinterpret_cast<const unsigned char*>(in);
+    unsigned char* d = reinterpret_cast<unsigned char*>(out);
+    for (size_t i = 0; i < size; i++) {
+        unsigned char c = s[i];
+        if (c < 0x80) {
+            d[i] = c >= 'A' && c <= 'Z' ? c + 32 : c;
+            continue;
+        }
+        d[i] = c;
+        if (i + 1 == size) break;
+        unsigned char next = s[i + 1];
+        if (c == 0xC3 && next >= 0x80 && next <= 0x9E && next != 0x97) {  // À-Þ but ×
+            next += 0x20;
+        } else if (c == 0xCE && next >= 0x91 && next <= 0x9F) {  // Α-Ο
+            next += 0x20;
+        } else if (c == 0xCE && next >= 0xA0 && next <= 0xA9 && next != 0xA2) {  // Π-Ω
+            d[i] = 0xCF;
+            next -= 0x20;
+        } else if (c == 0xD0 && next >= 0x80 && next <= 0x8F) {  // Ѐ-Џ
+            d[i] = 0xD1;
+            next += 0x10;
+        } else if (c == 0xD0 && next >= 0x90 && next <= 0x9F) {  // А-П
+            next += 0x20;
+        } else if (c == 0xD0 && next >= 0xA0 && next <= 0xAF) {  // Р-Я
+            d[i] = 0xD1;
+            next -= 0x20;
+        } else {
+            continue;
+        }
+        d[++i] = next;
+    }
+}
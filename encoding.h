@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+enum class Charset : unsigned char {
+    UTF8,
+    // single-byte, table driven; order matches charset_tables.inc
+    Windows1252,  // also what "iso-8859-1", "latin1" and "us-ascii" mean on the web
+    Windows1250,
+    Windows1251,
+    ISO8859_2,
+    ISO8859_15,
+    KOI8R,
+    // only ever chosen by a byte order mark
+    UTF16LE,
+    UTF16BE,
+};
+
+const char* CharsetName(Charset charset);
+
+// Charset for an encoding label as pages and servers write it ("UTF-8",
+// "latin1", "cp1251", ...). False for labels with no decoder here.
+bool CharsetFromLabel(std::string_view label, Charset& charset);
+
+// True if data is well-formed UTF-8: no overlong forms, surrogates, code
+// points past U+10FFFF or cut-off sequences. Checks 16 bytes per step with
+// the lookup-table method where the CPU has byte shuffles (SSSE3, NEON).
+bool IsValidUTF8(const char* data, size_t size);
+
+struct TextDecodeInfo {
+    Charset charset = Charset::UTF8;
+    const char* source = "default";  // "bom", "header", "meta" or "default"
+    bool converted = false;          // body was rewritten into a new buffer
+    size_t replaced = 0;             // invalid sequences turned into U+FFFD
+};
+
+// Turns a document body into UTF-8 in place. The charset comes from, in
+// order: a byte order mark, the charset parameter of contentType, a <meta>
+// in the first 1024 bytes, and otherwise UTF-8 if the bytes are valid UTF-8
+// and Windows-1252 if not.
+//
+// Valid UTF-8, and ASCII under any charset, is left where it is; only legacy
+// text and broken UTF-8 cost a copy.
+TextDecodeInfo DecodeToUTF8(std::string& body, std::string_view contentType);
+
+// Lowercases ASCII, Latin-1, Greek and Cyrillic capitals in UTF-8 text,
+// writing size bytes to out (which may be in). Every mapping keeps the byte
+// length, so offsets into the folded text are offsets into the original.
+void FoldCase(const char* in, size_t size, char* out);
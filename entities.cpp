@@ -0,0 +1,235 @@
+#include "entities.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+struct Entity {
+    const char* name;
+    const char* value;
+};
+
+constexpr Entity kEntities[] = {
+#include "html_entities.inc"
+};
+constexpr size_t kEntityCount = sizeof(kEntities) / sizeof(kEntities[0]);
+constexpr size_t kLongestName = 32;  // "CounterClockwiseContourIntegral;"
+constexpr size_t kLongestLegacy = 6;
+
+constexpr size_t Length(const char* s) {
+    size_t n = 0;
+    while (s[n]) n++;
+    return n;
+}
+
+constexpr uint32_t Hash(uint32_t seed, const char* s, size_t n) {
+    uint32_t h = seed;
+    for (size_t i = 0; i < n; i++) h = (h ^ static_cast<unsigned char>(s[i])) * 16777619u;
+    return h ^ (h >> 16);
+}
+
+// Hash-and-displace perfect hash: a name picks a bucket with one hash, and
+// the bucket's displacement picks the seed of a second hash that sends each
+// of its names to a slot no other name uses. Too many names for the single
+// seed search the atom table gets away with.
+constexpr size_t kBuckets = 1024;
+constexpr size_t kSlots = 4096;
+constexpr uint32_t kBucketSeed = 2166136261u;
+
+constexpr uint32_t SlotSeed(uint32_t displacement) {
+    return 0x811C9DC5u ^ (displacement * 0x9E3779B9u);
+}
+
+struct EntityTable {
+    uint16_t displacement[kBuckets] = {};
+    uint16_t slots[kSlots] = {};  // entity index + 1; 0 is empty
+    bool ok = true;
+};
+static_assert(kEntityCount < UINT16_MAX, "slots hold 16-bit indices");
+
+// Runs in the compiler. Buckets are placed largest first, while the table is
+// still empty enough for them to fit.
+constexpr EntityTable BuildTable() {
+    EntityTable table;
+    uint16_t bucketOf[kEntityCount] = {};
+    uint16_t bucketSize[kBuckets] = {};
+    for (size_t i = 0; i < kEntityCount; i++) {
+        bucketOf[i] = static_cast<uint16_t>(Hash(kBucketSeed, kEntities[i].name, Length(kEntities[i].name)) % kBuckets);
+        bucketSize[bucketOf[i]]++;
+    }
+    // group entity indices by bucket (counting sort)
+    uint16_t bucketStart[kBuckets + 1] = {};
+    for (size_t b = 0; b < kBuckets; b++) bucketStart[b + 1] = static_cast<uint16_t>(bucketStart[b] + bucketSize[b]);
+    uint16_t order[kEntityCount] = {};
+    uint16_t fill[kBuckets] = {};
+    for (size_t i = 0; i < kEntityCount; i++) {
+        order[bucketStart[bucketOf[i]] + fill[bucketOf[i]]++] = static_cast<uint16_t>(i);
+    }
+    uint16_t largest = 0;
+    for (size_t b = 0; b < kBuckets; b++) largest = bucketSize[b] > largest ? bucketSize[b] : largest;
+
+    for (uint16_t size = largest; size > 0; size--) {
+        for (size_t b = 0; b < kBuckets; b++) {
+            if (bucketSize[b] != size) continue;
+            bool placed = false;
+            for (uint32_t d = 0; d < UINT16_MAX && !placed; d++) {
+                size_t slots[16] = {};
+                placed = size <= 16;
+                for (uint16_t k = 0; k < size && placed; k++) {
+                    const char* name = kEntities[order[bucketStart[b] + k]].name;
+                    slots[k] = Hash(SlotSeed(d), name, Length(name)) % kSlots;
+                    placed = table.slots[slots[k]] == 0;
+                    for (uint16_t j = 0; j < k && placed; j++) placed = slots[j] != slots[k];
+                }
+                if (!placed) continue;
+                table.displacement[b] = static_cast<uint16_t>(d);
+                for (uint16_t k = 0; k < size; k++) {
+                    table.slots[slots[k]] = static_cast<uint16_t>(order[bucketStart[b] + k] + 1);
+                }
+            }
+            if (!placed) table.ok = false;
+        }
+    }
+    return table;
+}
+
+constexpr EntityTable kTable = BuildTable();
+static_assert(kTable.ok, "no perfect hash for the entity table");
+
+// What numeric references in 0x80-0x9F mean: the Windows-1252 characters
+// pages written in that encoding intended.
+const uint16_t kWindows1252[32] = {
+    0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+    0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+    0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+    0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178,
+};
+
+bool IsAlnum(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+int HexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+size_t EncodeUTF8(uint32_t c, char* out) {
+    if (c < 0x80) {
+        out[0] = static_cast<char>(c);
+        return 1;
+    }
+    if (c < 0x800) {
+        out[0] = static_cast<char>(0xC0 | (c >> 6));
+        out[1] = static_cast<char>(0x80 | (c & 0x3F));
+        return 2;
+    }
+    if (c < 0x10000) {
+        out[0] = static_cast<char>(0xE0 | (c >> 12));
+        out[1] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        out[2] = static_cast<char>(0x80 | (c & 0x3F));
+        return 3;
+    }
+    out[0] = static_cast<char>(0xF0 | (c >> 18));
+    out[1] = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+    out[2] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+    out[3] = static_cast<char>(0x80 | (c & 0x3F));
+    return 4;
+}
+
+// Decodes the reference starting at s[0] == '&'. Returns how many input
+// bytes it covers and fills out/outSize, or returns 0 if it is not one.
+size_t DecodeReference(const char* s, size_t size, bool inAttribute, char* out, size_t& outSize) {
+    if (size >= 2 && s[1] == '#') {
+        bool hex = size >= 3 && (s[2] == 'x' || s[2] == 'X');
+        size_t i = hex ? 3 : 2;
+        size_t digits = i;
+        uint32_t code = 0;
+        for (; i < size; i++) {
+            int v = hex ? HexValue(s[i]) : (s[i] >= '0' && s[i] <= '9' ? s[i] - '0' : -1);
+            if (v < 0) break;
+            code = code > 0x10FFFF ? code : code * (hex ? 16 : 10) + v;  // saturate
+        }
+        if (i == digits) return 0;
+        if (i < size && s[i] == ';') i++;
+        if (code == 0 || code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF)) code = 0xFFFD;
+        else if (code >= 0x80 && code <= 0x9F) code = kWindows1252[code - 0x80];
+        outSize = EncodeUTF8(code, out);
+        return i;
+    }
+
+    size_t run = 1;
+    while (run < size && run <= kLongestName && IsAlnum(s[run])) run++;
+    if (run < size && s[run] == ';') {
+        if (const char* value = LookupEntity(s + 1, run)) {
+            outSize = strlen(value);
+            memcpy(out, value, outSize);
+            return run + 1;
+        }
+    }
+    // legacy names may end without ';', and the longest one that fits wins
+    for (size_t length = std::min(run - 1, kLongestLegacy); length >= 2; length--) {
+        const char* value = LookupEntity(s + 1, length);
+        if (!value) continue;
+        size_t end = 1 + length;
+        if (inAttribute && end < size && (IsAlnum(s[end]) || s[end] == '=')) return 0;
+        outSize = strlen(value);
+        memcpy(out, value, outSize);
+        return end;
+    }
+    return 0;
+}
+
+}  // namespace
+
+const char* LookupEntity(const char* name, size_t length) {
+    if (length == 0 || length > kLongestName) return nullptr;
+    uint32_t bucket = Hash(kBucketSeed, name, length) % kBuckets;
+    uint16_t index = kTable.slots[Hash(SlotSeed(kTable.displacement[bucket]), name, length) % kSlots];
+    if (!index) return nullptr;
+    const Entity& entity = kEntities[index - 1];
+    return strncmp(entity.name, name, length) == 0 && entity.name[length] == '\0' ? entity.value : nullptr;
+}
+
+void DecodeEntities(std::string& text, bool inAttribute) {
+    size_t read = text.find('&');
+    if (read == std::string::npos) return;
+
+    // Decoded text is never longer than its reference, except for &nGt; and
+    // &nLt; which gain a byte; those finish in a copy.
+    char* data = &text[0];
+    size_t size = text.size();
+    size_t write = read;
+    while (read < size) {
+        const char* amp = static_cast<const char*>(memchr(data + read, '&', size - read));
+        size_t next = amp ? amp - data : size;
+        memmove(data + write, data + read, next - read);
+        write += next - read;
+        read = next;
+        if (read == size) break;
+
+        char decoded[8];
+        size_t decodedSize = 0;
+        size_t consumed = DecodeReference(data + read, size - read, inAttribute, decoded, decodedSize);
+        if (consumed == 0) {
+            data[write++] = data[read++];
+            continue;
+        }
+        if (decodedSize > consumed + (read - write)) {
+            std::string grown(data, write);
+            grown.append(decoded, decodedSize);
+            std::string rest = text.substr(read + consumed);
+            DecodeEntities(rest, inAttribute);
+            grown += rest;
+            text.swap(grown);
+            return;
+        }
+        memcpy(data + write, decoded, decodedSize);
+        write += decodedSize;
+        read += consumed;
+    }
+    text.resize(write);
+}
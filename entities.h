@@ -0,0 +1,17 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Replaces character references (&amp; &#39; &#x2014; &nbsp; ...) with their
+// UTF-8 text, in place. Follows the HTML5 rules: the full named-reference
+// list including the legacy forms without ';', longest match wins, and
+// numeric references to nothing printable become U+FFFD. Inside attribute
+// values a legacy reference followed by an alphanumeric or '=' is left as
+// typed, so query strings like "?a=1&copy=2" survive.
+//
+// Leaves text untouched and allocates nothing unless it contains '&'.
+void DecodeEntities(std::string& text, bool inAttribute = false);
+
+// UTF-8 value of a named reference (without the '&', with the ';' if the
+// form has one), or nullptr.
+const char* LookupEntity(const char* name, size_t length);
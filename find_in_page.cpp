@@ -0,0 +1,141 @@
+#include "find_in_page.h"
+#include <cstring>
+#include "encoding.h"
+#include "imgui.h"
+#include "simd.h"
+#include "trace.h"
+
+static constexpr size_t kMaxMatches = 10000;
+
+void FindInPage::Index(const HTMLNode& node) {
+    if (node.tag == Atom::Text) {
+        m_segments[&node] = static_cast<uint32_t>(m_text.size());
+        size_t at = m_text.size();
+        m_text.resize(at + node.text.size() + 1);
+        FoldCase(node.text.data(), node.text.size(), &m_text[at]);
+        m_text.back() = '\0';  // keeps matches inside one node
+        return;
+    }
+    // a link draws only its direct text, so that is all that can be found
+    bool link = node.tag == Atom::A && node.FindAttr(Atom::Href);
+    for (const HTMLNode& child : node.children) {
+        if (!link || child.tag == Atom::Text) Index(child);
+    }
+}
+
+void FindInPage::SetPage(const HTMLNode& root) {
+    TRACE_SCOPE("page", "FindInPage::SetPage");
+    m_text.clear();
+    m_segments.clear();
+    Index(root);
+    m_matches.clear();
+    m_query.clear();
+    m_current = 0;
+    if (visible) Search();
+}
+
+void FindInPage::Search() {
+    int64_t start = trace::NowUs();
+    std::string query(strlen(m_input), '\0');
+    FoldCase(m_input, query.size(), &query[0]);
+
+    uint32_t currentAt = m_matches.empty() ? 0 : m_matches[m_current];
+    bool narrowed = !m_capped && !m_query.empty() && query.size() > m_query.size() &&
+                    query.compare(0, m_query.size(), m_query) == 0;
+    if (query.empty()) {
+        m_matches.clear();
+        m_capped = false;
+    } else if (narrowed) {
+        // every match of the longer query starts where the shorter one matched
+        size_t kept = 0;
+        for (uint32_t at : m_matches) {
+            if (m_text.compare(at, query.size(), query) == 0) m_matches[kept++] = at;
+        }
+        m_matches.resize(kept);
+    } else {
+        m_matches.clear();
+        m_capped = false;
+        const char* begin = m_text.data();
+        const char* end = begin + m_text.size();
+        for (const char* p = begin; (p = FindSubstring(p, end, query.data(), query.size())) != end; p++) {
+            if (m_matches.size() == kMaxMatches) {
+                m_capped = true;
+                break;
+            }
+            m_matches.push_back(static_cast<uint32_t>(p - begin));
+        }
+    }
+    m_query = std::move(query);
+
+    // stay where the reader was: the first match at or after the old one
+    m_current = std::lower_bound(m_matches.begin(), m_matches.end(), currentAt) - m_matches.begin();
+    if (m_current == m_matches.size()) m_current = 0;
+    m_scrollPending = !m_matches.empty();
+    m_searchMs = (trace::NowUs() - start) / 1000.0;
+}
+
+void FindInPage::Step(int direction) {
+    if (m_matches.empty()) return;
+    m_current = (m_current + m_matches.size() + direction) % m_matches.size();
+    m_scrollPending = true;
+}
+
+void FindInPage::Close() {
+    visible = false;
+    m_matches.clear();
+    m_query.clear();
+    m_capped = false;
+    m_scrollPending = false;
+}
+
+void FindInPage::Draw() {
+    if (ImGui::IsKeyChordPressed(ImGuiMod_Ctrl | ImGuiKey_F)) {
+        bool reopened = !visible;
+        visible = true;
+        m_focusInput = true;
+        if (reopened && m_input[0]) Search();
+    }
+    if (!visible) return;
+    bool back = ImGui::GetIO().KeyShift;
+    if (ImGui::IsKeyPressed(ImGuiKey_F3)) Step(back ? -1 : 1);
+    if (ImGui::IsKeyPressed(ImGuiKey_Escape, false)) {
+        Close();
+        return;
+    }
+
+    ImGui::AlignTextToFramePadding();
+    ImGui::TextUnformatted("Find:");
+    ImGui::SameLine();
+    if (m_focusInput) {
+        ImGui::SetKeyboardFocusHere();
+        m_focusInput = false;
+    }
+    ImGui::SetNextItemWidth(260.0f);
+    if (ImGui::InputText("##Find", m_input, IM_ARRAYSIZE(m_input))) {
+        Search();
+    }
+    // Enter ends editing; step and take the focus straight back
+    if (ImGui::IsItemDeactivated() && ImGui::IsKeyPressed(ImGuiKey_Enter)) {
+        Step(back ? -1 : 1);
+        m_focusInput = true;
+    }
+
+    const float buttonSize = ImGui::GetFrameHeight();
+    ImGui::SameLine();
+    if (ImGui::Button("^", ImVec2(buttonSize, 0))) Step(-1);
+    ImGui::SameLine();
+    if (ImGui::Button("v", ImVec2(buttonSize, 0))) Step(1);
+    ImGui::SameLine();
+    if (ImGui::Button("x", ImVec2(buttonSize, 0))) {
+        Close();
+        return;
+    }
+    ImGui::SameLine();
+    if (m_query.empty()) {
+        ImGui::TextUnformatted("");
+    } else if (m_matches.empty()) {
+        ImGui::TextColored(ImVec4(1, 0.4f, 0.4f, 1), "No matches");
+    } else {
+        ImGui::TextDisabled("%zu of %zu%s", m_current + 1, m_matches.size(), m_capped ? "+" : "");
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "html_parser.h"
+
+// Ctrl+F over the text of the shown page. The text of every rendered text
+// node is case-folded once per page into one buffer; a keystroke that grows
+// the query only re-checks the previous matches, anything else rescans the
+// buffer with FindSubstring. Drawn as a bar above the page, while
+// RenderPage highlights the matches and scrolls to the current one.
+class FindInPage {
+public:
+    bool visible = false;
+
+    // Indexes a newly parsed page and reruns the query over it. root must
+    // stay alive and unchanged until the next call.
+    void SetPage(const HTMLNode& root);
+
+    // The find bar: opens on Ctrl+F, steps with Enter, Shift+Enter and F3,
+    // closes on Escape.
+    void Draw();
+
+    size_t MatchCount() const { return m_matches.size(); }
+    double LastSearchMs() const { return m_searchMs; }
+
+    // Calls fn(begin, end, current) with byte offsets into node.text for each
+    // match inside that node, in order.
+    template <typename Fn>
+    void ForEachMatch(const HTMLNode& node, Fn&& fn) const;
+
+    // The current match changed and should be scrolled into view; the
+    // renderer clears it once it has done so.
+    bool ScrollPending() const { return m_scrollPending; }
+    void ScrollDone() { m_scrollPending = false; }
+
+private:
+    void Index(const HTMLNode& node);
+    void Search();
+    void Step(int direction);
+    void Close();
+
+    std::string m_text;  // folded text of every text node, each followed by '\0'
+    std::unordered_map<const HTMLNode*, uint32_t> m_segments;  // node -> offset of its text
+    std::string m_query;              // folded; what m_matches hold
+    std::vector<uint32_t> m_matches;  // offsets into m_text, ascending
+    bool m_capped = false;            // stopped at kMaxMatches
+    size_t m_current = 0;
+    bool m_scrollPending = false;
+    bool m_focusInput = false;
+    double m_searchMs = 0;
+    char m_input[256] = "";
+};
+
+template <typename Fn>
+void FindInPage::ForEachMatch(const HTMLNode& node, Fn&& fn) const {
+    if (m_matches.empty()) return;
+    auto segment = m_segments.find(&node);
+    if (segment == m_segments.end()) return;
+    uint32_t base = segment->second;
+    uint32_t length = static_cast<uint32_t>(m_query.size());
+    auto first = std::lower_bound(m_matches.begin(), m_matches.end(), base);
+    for (auto m = first; m != m_matches.end() && *m < base + node.text.size(); ++m) {
+        fn(*m - base, *m - base + length, static_cast<size_t>(m - m_matches.begin()) == m_current);
+    }
+}
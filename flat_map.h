@@ -0,0 +1,118 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Hash map from nonzero 64-bit keys (URLIds, packed ids) to values, stored
+// in one array with linear probing: a lookup is a multiply and, usually, one
+// cache line. Key 0 marks an empty slot. Inserting may move every value, so
+// pointers into the map last until the next insert; Erase moves later
+// values of the same probe run back into the hole.
+template <typename T>
+class FlatMap {
+public:
+    size_t Size() const { return m_size; }
+    bool Empty() const { return m_size == 0; }
+
+    T* Find(uint64_t key) {
+        if (m_size == 0) return nullptr;
+        for (size_t i = Home(key);; i = (i + 1) & m_mask) {
+            if (m_slots[i].key == key) return &m_slots[i].value;
+            if (m_slots[i].key == 0) return nullptr;
+        }
+    }
+    const T* Find(uint64_t key) const { return const_cast<FlatMap*>(this)->Find(key); }
+    bool Contains(uint64_t key) const { return Find(key) != nullptr; }
+
+    // The value for key, default-constructed if it was missing.
+    T& operator[](uint64_t key) { return Insert(key).first; }
+
+    // The value for key and whether it was just added.
+    std::pair<T&, bool> Insert(uint64_t key) {
+        if ((m_size + 1) * 2 > m_slots.size()) Rehash(m_slots.empty() ? 16 : m_slots.size() * 2);
+        size_t i = Home(key);
+        for (; m_slots[i].key != 0; i = (i + 1) & m_mask) {
+            if (m_slots[i].key == key) return {m_slots[i].value, false};
+        }
+        m_slots[i].key = key;
+        m_size++;
+        return {m_slots[i].value, true};
+    }
+
+    bool Erase(uint64_t key) {
+        if (m_size == 0) return false;
+        size_t hole = Home(key);
+        for (; m_slots[hole].key != key; hole = (hole + 1) & m_mask) {
+            if (m_slots[hole].key == 0) return false;
+        }
+        // backward shift: pull up each later entry the hole would hide
+        for (size_t i = (hole + 1) & m_mask; m_slots[i].key != 0; i = (i + 1) & m_mask) {
+            if (((i - Home(m_slots[i].key)) & m_mask) >= ((i - hole) & m_mask)) {
+                m_slots[hole] = std::move(m_slots[i]);
+                hole = i;
+            }
+        }
+        m_slots[hole] = Slot();
+        m_size--;
+        return true;
+    }
+
+    // Calls fn(key, value) for every entry, in no particular order.
+    template <typename Fn>
+    void ForEach(Fn&& fn) {
+        for (Slot& slot : m_slots) {
+            if (slot.key != 0) fn(slot.key, slot.value);
+        }
+    }
+
+    // Removes the entries for which fn(key, value) is true, calling it once
+    // per entry.
+    template <typename Fn>
+    void EraseIf(Fn&& fn) {
+        size_t erased = 0;
+        for (Slot& slot : m_slots) {
+            if (slot.key != 0 && fn(slot.key, slot.value)) {
+                slot = Slot();
+                erased++;
+            }
+        }
+        if (erased == 0) return;
+        m_size -= erased;
+        Rehash(m_slots.size());
+    }
+
+    void Clear() {
+        m_slots.clear();
+        m_mask = 0;
+        m_size = 0;
+    }
+
+private:
+    struct Slot {
+        uint64_t key = 0;
+        T value{};
+    };
+
+    size_t Home(uint64_t key) const {
+        // Fibonacci hashing: sequential ids and aligned pointers spread out
+        return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & m_mask;
+    }
+
+    void Rehash(size_t capacity) {
+        std::vector<Slot> old;
+        old.swap(m_slots);
+        m_slots.resize(capacity);
+        m_mask = capacity - 1;
+        for (Slot& slot : old) {
+            if (slot.key == 0) continue;
+            size_t i = Home(slot.key);
+            while (m_slots[i].key != 0) i = (i + 1) & m_mask;
+            m_slots[i] = std::move(slot);
+        }
+    }
+
+    std::vector<Slot> m_slots;  // power-of-two size, at most half full
+    size_t m_mask = 0;
+    size_t m_size = 0;
+};
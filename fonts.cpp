@@ -0,0 +1,465 @@
+#include "fonts.h"
+#include "html_parser.h"
+#include "imgui_internal.h"
+#include "trace.h"
+#include <dirent.h>
+#include <sys/stat.h>
+#include <utime.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <map>
+
+namespace {
+
+struct FontSpec {
+    const char* path;  // nullptr: the built-in font
+    float size;
+};
+
+const FontSpec kFonts[] = {
+    {nullptr, 13.0f},                                                   // body
+    {"/System/Library/Fonts/Supplemental/Arial Bold.ttf", 24.0f},       // headings
+    {"/System/Library/Fonts/Supplemental/Arial Bold.ttf", 16.0f},       // bold
+    {"/System/Library/Fonts/Supplemental/Arial Italic.ttf", 16.0f},     // italic
+};
+
+// First one present covers blocks the page fonts lack.
+const char* kFallbackFaces[] = {
+    "/System/Library/Fonts/Supplemental/Arial Unicode.ttf",
+    "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf",
+    "/usr/share/fonts/TTF/DejaVuSans.ttf",
+};
+
+// Bump when the cache layout changes.
+const uint32_t kCacheVersion = 2;
+
+// Baked atlases kept on disk; each block set seen adds one.
+const size_t kCachedAtlases = 8;
+
+struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    int32_t width;
+    int32_t height;
+    int32_t rects;
+    int32_t fonts;
+};
+
+struct CachedFont {
+    float ascent;
+    float descent;
+    uint32_t fallbackChar;
+    uint32_t ellipsisChar;
+    uint32_t glyphs;
+};
+
+struct CachedGlyph {
+    uint32_t codepoint;
+    float advance;
+    float x0, y0, x1, y1;
+    float u0, v0, u1, v1;
+};
+
+// A baked atlas as read back from disk.
+struct CachedAtlas {
+    CacheHeader header;
+    std::vector<uint16_t> rects;  // x, y of each custom rect
+    std::vector<CachedFont> fonts;
+    std::vector<std::vector<CachedGlyph>> glyphs;
+    std::vector<unsigned char> pixels;  // alpha8
+};
+
+const CachedAtlas* g_restoring = nullptr;
+
+void Mix(uint64_t& hash, const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+}
+
+std::string CacheDir() {
+    std::string dir;
+    if (const char* xdg = getenv("XDG_CACHE_HOME")) {
+        dir = xdg;
+    } else if (const char* home = getenv("HOME")) {
+#ifdef __APPLE__
+        dir = std::string(home) + "/Library/Caches";
+#else
+        dir = std::string(home) + "/.cache";
+#endif
+    } else {
+        return "";
+    }
+    mkdir(dir.c_str(), 0755);
+    dir += "/SimpleBrowser";
+    mkdir(dir.c_str(), 0755);
+    return dir;
+}
+
+struct HashIndexEntry {
+    int64_t size;
+    int64_t mtime;
+    uint64_t hash;
+};
+
+// Content hash of a font file. Hashing a large face costs a full read, so
+// results are remembered in fonts.idx against the file's size and mtime.
+uint64_t FontFileHash(const std::string& path) {
+    static std::map<std::string, HashIndexEntry> index;
+    static bool loaded = false;
+    std::string dir = CacheDir();
+    std::string indexPath = dir.empty() ? "" : dir + "/fonts.idx";
+    if (!loaded && !indexPath.empty()) {
+        loaded = true;
+        if (FILE* f = fopen(indexPath.c_str(), "r")) {
+            char line[1200];
+            while (fgets(line, sizeof(line), f)) {
+                unsigned long long hash;
+                long long size, mtime;
+                int used = 0;
+                if (sscanf(line, "%llx %lld %lld %n", &hash, &size, &mtime, &used) != 3 || !used) continue;
+                std::string name = line + used;
+                while (!name.empty() && (name.back() == '\n' || name.back() == '\r')) name.pop_back();
+                index[name] = {size, mtime, hash};
+            }
+            fclose(f);
+        }
+    }
+
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return 0;
+    auto it = index.find(path);
+    if (it != index.end() && it->second.size == st.st_size && it->second.mtime == st.st_mtime) {
+        return it->second.hash;
+    }
+
+    TRACE_SCOPE_ARG("fonts", "HashFontFile", path.c_str());
+    uint64_t hash = 14695981039346656037ull;
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return 0;
+    std::vector<unsigned char> chunk(1 << 16);
+    while (size_t n = fread(chunk.data(), 1, chunk.size(), f)) Mix(hash, chunk.data(), n);
+    fclose(f);
+    index[path] = {static_cast<int64_t>(st.st_size), static_cast<int64_t>(st.st_mtime), hash};
+
+    if (!indexPath.empty()) {
+        if (FILE* out = fopen(indexPath.c_str(), "w")) {
+            for (const auto& entry : index) {
+                fprintf(out, "%016llx %lld %lld %s\n", static_cast<unsigned long long>(entry.second.hash),
+                        static_cast<long long>(entry.second.size), static_cast<long long>(entry.second.mtime),
+                        entry.first.c_str());
+            }
+            fclose(out);
+        }
+    }
+    return hash;
+}
+
+bool ReadCache(const std::string& path, uint64_t key, CachedAtlas& cache) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    CacheHeader& header = cache.header;
+    bool ok = fread(&header, sizeof(header), 1, f) == 1 && memcmp(header.magic, "SBFA", 4) == 0 &&
+              header.version == kCacheVersion && header.key == key && header.width > 0 && header.height > 0 &&
+              header.rects >= 0 && header.fonts >= 0 && header.fonts <= 64;
+    if (ok) {
+        cache.rects.resize(header.rects * 2);
+        ok = fread(cache.rects.data(), sizeof(uint16_t), cache.rects.size(), f) == cache.rects.size();
+    }
+    cache.fonts.resize(ok ? header.fonts : 0);
+    cache.glyphs.resize(cache.fonts.size());
+    for (size_t i = 0; ok && i < cache.fonts.size(); i++) {
+        ok = fread(&cache.fonts[i], sizeof(CachedFont), 1, f) == 1 && cache.fonts[i].glyphs <= 0x10000;
+        if (!ok) break;
+        cache.glyphs[i].resize(cache.fonts[i].glyphs);
+        ok = fread(cache.glyphs[i].data(), sizeof(CachedGlyph), cache.glyphs[i].size(), f) == cache.glyphs[i].size();
+    }
+    if (ok) {
+        cache.pixels.resize(static_cast<size_t>(header.width) * header.height);
+        ok = fread(cache.pixels.data(), 1, cache.pixels.size(), f) == cache.pixels.size();
+    }
+    fclose(f);
+    return ok;
+}
+
+void WriteCache(const std::string& path, uint64_t key, ImFontAtlas* atlas) {
+    unsigned char* pixels = nullptr;
+    int width = 0, height = 0;
+    atlas->GetTexDataAsAlpha8(&pixels, &width, &height);
+    if (!pixels) return;
+
+    // write beside the final name and rename, so a concurrent launch never
+    // reads half a file
+    std::string temp = path + ".tmp";
+    FILE* f = fopen(temp.c_str(), "wb");
+    if (!f) return;
+    CacheHeader header = {{'S', 'B', 'F', 'A'}, kCacheVersion, key, width, height,
+                          atlas->CustomRects.Size, atlas->Fonts.Size};
+    fwrite(&header, sizeof(header), 1, f);
+    for (const ImFontAtlasCustomRect& rect : atlas->CustomRects) {
+        uint16_t xy[2] = {rect.X, rect.Y};
+        fwrite(xy, sizeof(xy), 1, f);
+    }
+    for (const ImFont* font : atlas->Fonts) {
+        CachedFont meta = {font->Ascent, font->Descent, font->FallbackChar, font->EllipsisChar,
+                           static_cast<uint32_t>(font->Glyphs.Size)};
+        fwrite(&meta, sizeof(meta), 1, f);
+        for (const ImFontGlyph& glyph : font->Glyphs) {
+            CachedGlyph g = {glyph.Codepoint, glyph.AdvanceX, glyph.X0, glyph.Y0, glyph.X1, glyph.Y1,
+                             glyph.U0, glyph.V0, glyph.U1, glyph.V1};
+            fwrite(&g, sizeof(g), 1, f);
+        }
+    }
+    fwrite(pixels, 1, static_cast<size_t>(width) * height, f);
+    bool ok = ferror(f) == 0;
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(temp.c_str(), path.c_str()) != 0) remove(temp.c_str());
+}
+
+// Deletes all but the kCachedAtlases most recently used atlases in dir, and
+// temp files a crashed writer left behind. Reads touch their file, so mtime
+// orders the atlases by last use.
+void PruneCache(const std::string& dir) {
+    DIR* d = opendir(dir.c_str());
+    if (!d) return;
+    std::vector<std::pair<time_t, std::string>> atlases;
+    time_t now = time(nullptr);
+    while (dirent* entry = readdir(d)) {
+        std::string name = entry->d_name;
+        if (name.compare(0, 6, "fonts-") != 0) continue;
+        std::string path = dir + "/" + name;
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) continue;
+        if (name.size() > 8 && name.compare(name.size() - 8, 8, ".bin.tmp") == 0) {
+            if (now - st.st_mtime > 3600) remove(path.c_str());  // not one being written right now
+        } else if (name.size() > 4 && name.compare(name.size() - 4, 4, ".bin") == 0) {
+            atlases.emplace_back(st.st_mtime, path);
+        }
+    }
+    closedir(d);
+    if (atlases.size() <= kCachedAtlases) return;
+    std::sort(atlases.begin(), atlases.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+    for (size_t i = kCachedAtlases; i < atlases.size(); i++) remove(atlases[i].second.c_str());
+}
+
+// ImFontBuilderIO that lays a cached bake back into the atlas instead of
+// rasterizing. Mirrors the stb_truetype builder: reserve the custom rects,
+// place every glyph, then let ImGui render its own cursor and line data.
+bool BuildFromCache(ImFontAtlas* atlas) {
+    const CachedAtlas& cache = *g_restoring;
+    atlas->ClearTexData();
+    ImFontAtlasBuildInit(atlas);
+    if (atlas->CustomRects.Size * 2 != static_cast<int>(cache.rects.size()) ||
+        atlas->Fonts.Size != static_cast<int>(cache.fonts.size())) {
+        return false;
+    }
+    atlas->TexWidth = cache.header.width;
+    atlas->TexHeight = cache.header.height;
+    atlas->TexUvScale = ImVec2(1.0f / atlas->TexWidth, 1.0f / atlas->TexHeight);
+    atlas->TexPixelsAlpha8 = static_cast<unsigned char*>(IM_ALLOC(cache.pixels.size()));
+    memcpy(atlas->TexPixelsAlpha8, cache.pixels.data(), cache.pixels.size());
+    for (int i = 0; i < atlas->CustomRects.Size; i++) {
+        atlas->CustomRects[i].X = cache.rects[i * 2];
+        atlas->CustomRects[i].Y = cache.rects[i * 2 + 1];
+    }
+    int font = -1;
+    for (ImFontConfig& config : atlas->ConfigData) {
+        if (config.MergeMode) {
+            // merged faces only count as sources; their glyphs are in the cache already
+            ImFontAtlasBuildSetupFont(atlas, config.DstFont, &config, 0, 0);
+            continue;
+        }
+        const CachedFont& meta = cache.fonts[++font];
+        ImFontAtlasBuildSetupFont(atlas, config.DstFont, &config, meta.ascent, meta.descent);
+        config.DstFont->FallbackChar = static_cast<ImWchar>(meta.fallbackChar);
+        config.DstFont->EllipsisChar = static_cast<ImWchar>(meta.ellipsisChar);
+        // glyphs were stored after offsets and snapping, so no config here
+        for (const CachedGlyph& g : cache.glyphs[font]) {
+            config.DstFont->AddGlyph(nullptr, static_cast<ImWchar>(g.codepoint), g.x0, g.y0, g.x1, g.y1,
+                                     g.u0, g.v0, g.u1, g.v1, g.advance);
+        }
+    }
+    ImFontAtlasBuildFinish(atlas);
+    return true;
+}
+
+bool RestoreFromCache(ImFontAtlas* atlas, const CachedAtlas& cache) {
+    static const ImFontBuilderIO cacheBuilder = {BuildFromCache};
+    g_restoring = &cache;
+    atlas->FontBuilderIO = &cacheBuilder;
+    bool ok = atlas->Build();
+    atlas->FontBuilderIO = nullptr;
+    g_restoring = nullptr;
+    return ok;
+}
+
+}  // namespace
+
+FontManager::FontManager(ImFontAtlas* atlas) : m_atlas(atlas) {
+    for (const FontSpec& spec : kFonts) {
+        struct stat st;
+        if (spec.path && stat(spec.path, &st) != 0) {
+            std::cerr << "[Font] " << spec.path << " not found, using the default font" << std::endl;
+            m_faces.push_back({"", 13.0f});
+            continue;
+        }
+        m_faces.push_back({spec.path ? spec.path : "", spec.size});
+    }
+    for (const char* path : kFallbackFaces) {
+        struct stat st;
+        if (stat(path, &st) == 0) {
+            m_fallback.path = path;
+            break;
+        }
+    }
+    // Latin-1, what ImGui bakes by default
+    m_blocks.set(0);
+    m_blocks.set(1);
+    m_requested = m_blocks;
+    Build();
+}
+
+void FontManager::RequestText(const std::string& text) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(text.data());
+    const unsigned char* end = p + text.size();
+    while (p < end) {
+        unsigned c = *p;
+        if (c < 0x80) {
+            p++;
+            continue;
+        }
+        int length;
+        if ((c & 0xE0) == 0xC0) {
+            length = 2;
+            c &= 0x1F;
+        } else if ((c & 0xF0) == 0xE0) {
+            length = 3;
+            c &= 0x0F;
+        } else {
+            p++;  // stray continuation byte, or a 4-byte sequence past what ImWchar holds
+            continue;
+        }
+        if (end - p < length) break;
+        for (int i = 1; i < length; i++) c = (c << 6) | (p[i] & 0x3F);
+        p += length;
+        m_requested.set(c / kBlockSize);
+    }
+}
+
+void FontManager::RequestPage(const HTMLNode& root) {
+    if (root.tag == Atom::Text) RequestText(root.text);
+    for (const HTMLNode& child : root.children) RequestPage(child);
+}
+
+bool FontManager::Update() {
+    if (m_requested == m_blocks) return false;
+    m_blocks = m_requested;
+    Build();
+    return true;
+}
+
+uint64_t FontManager::CacheKey() const {
+    uint64_t hash = 14695981039346656037ull;
+    int version = IMGUI_VERSION_NUM;
+    Mix(hash, &version, sizeof(version));
+    Mix(hash, &kCacheVersion, sizeof(kCacheVersion));
+    for (const Face& face : m_faces) {
+        uint64_t file = face.path.empty() ? 0 : FontFileHash(face.path);
+        Mix(hash, &face.size, sizeof(face.size));
+        Mix(hash, &file, sizeof(file));
+    }
+    if (Wide() && !m_fallback.path.empty()) {
+        uint64_t file = FontFileHash(m_fallback.path);
+        Mix(hash, &file, sizeof(file));
+    }
+    for (uint16_t block = 0; block < kBlocks; block++) {
+        if (m_blocks[block]) Mix(hash, &block, sizeof(block));
+    }
+    return hash;
+}
+
+// Every face at its size, plus the fallback face merged underneath when
+// blocks past Latin-1 are wanted. With placeholders the fonts carry no TTF
+// data and can only be built from the cache.
+void FontManager::AddFonts(bool placeholders) {
+    static unsigned char placeholder = 0;  // AddFont insists on some font data
+    bool wide = Wide() && !m_fallback.path.empty();
+    for (const Face& face : m_faces) {
+        for (int merge = 0; merge < (wide ? 2 : 1); merge++) {
+            const std::string& path = merge ? m_fallback.path : face.path;
+            ImFontConfig config;
+            config.SizePixels = face.size;
+            config.GlyphRanges = m_ranges.data();
+            config.MergeMode = merge != 0;
+            if (placeholders) {
+                config.FontData = &placeholder;
+                config.FontDataSize = 1;
+                config.FontDataOwnedByAtlas = false;
+                snprintf(config.Name, sizeof(config.Name), "%s, %.0fpx",
+                         path.empty() ? "ProggyClean.ttf" : path.substr(path.rfind('/') + 1).c_str(), face.size);
+                m_atlas->AddFont(&config);
+            } else if (path.empty()) {
+                m_atlas->AddFontDefault(&config);
+            } else {
+                m_atlas->AddFontFromFileTTF(path.c_str(), face.size, &config, m_ranges.data());
+            }
+        }
+    }
+}
+
+void FontManager::Build() {
+    TRACE_SCOPE("fonts", "Build");
+    m_ranges.clear();
+    for (int block = 0; block < kBlocks;) {
+        if (!m_blocks[block]) {
+            block++;
+            continue;
+        }
+        int first = block;
+        while (block < kBlocks && m_blocks[block]) block++;
+        m_ranges.push_back(static_cast<ImWchar>(std::max(first * kBlockSize, 0x20)));
+        m_ranges.push_back(static_cast<ImWchar>(block * kBlockSize - 1));
+    }
+    m_ranges.push_back(0);
+
+    uint64_t key = CacheKey();
+    std::string dir = CacheDir();
+    char name[40];
+    snprintf(name, sizeof(name), "/fonts-%016llx.bin", static_cast<unsigned long long>(key));
+    std::string path = dir.empty() ? "" : dir + name;
+    m_atlas->Clear();
+    m_fromCache = false;
+
+#if IMGUI_VERSION_NUM < 19200  // 1.92 bakes glyphs on demand, with no atlas to cache
+    CachedAtlas cache;
+    if (!path.empty() && ReadCache(path, key, cache)) {
+        AddFonts(true);
+        if (RestoreFromCache(m_atlas, cache)) {
+            utime(path.c_str(), nullptr);  // most recently used, for PruneCache
+            m_fromCache = true;
+            return;
+        }
+        std::cerr << "[Font] " << path << " does not match this build, rebaking" << std::endl;
+        m_atlas->Clear();
+    }
+#endif
+
+    AddFonts(false);
+#if IMGUI_VERSION_NUM < 19200
+    int64_t start = trace::NowUs();
+    m_atlas->Build();
+    std::cerr << "[Font] Baked " << m_blocks.count() << " glyph blocks in " << (trace::NowUs() - start) / 1000.0
+              << " ms" << std::endl;
+    if (!path.empty()) {
+        WriteCache(path, key, m_atlas);
+        PruneCache(dir);
+    }
+#endif
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "imgui.h"
+#include <bitset>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct HTMLNode;
+
+// Owns the page fonts, in the order the renderer indexes them: 0 body, 1
+// headings, 2 bold, 3 italic. A face missing on this system falls back to
+// the built-in font so the indices stay valid.
+//
+// Only Latin-1 is baked at first. Pages report the text they show, and
+// characters outside what the atlas has add their 128-codepoint block on the
+// next Update(), merged from a fallback face with wide coverage. Every bake
+// is saved under the user cache directory, keyed by the font files' content
+// hashes, sizes and blocks, so a block set seen before loads without
+// rasterizing. Only the most recently used few are kept.
+class FontManager {
+public:
+    // Builds the atlas before returning.
+    explicit FontManager(ImFontAtlas* atlas);
+
+    // Notes characters to have glyphs for; UTF-8. Cheap for ASCII.
+    void RequestText(const std::string& text);
+    void RequestPage(const HTMLNode& root);
+
+    // Between frames only: rebakes when requested characters are missing.
+    // Returns true if the atlas texture changed and needs uploading again.
+    bool Update();
+
+    // The most recent bake came from the disk cache.
+    bool LoadedFromCache() const { return m_fromCache; }
+
+private:
+    static const int kBlockSize = 128;
+    static const int kBlocks = 0x10000 / kBlockSize;  // ImWchar is 16-bit
+
+    struct Face {
+        std::string path;  // empty: the built-in font
+        float size = 0;
+    };
+
+    void Build();
+    void AddFonts(bool placeholders);
+    bool Wide() const { return (m_blocks >> 2).any(); }  // anything past Latin-1
+    uint64_t CacheKey() const;
+
+    ImFontAtlas* m_atlas;
+    std::vector<Face> m_faces;
+    Face m_fallback;              // merged into every font for non-Latin blocks
+    std::bitset<kBlocks> m_blocks;     // baked
+    std::bitset<kBlocks> m_requested;  // baked or waiting for Update()
+    std::vector<ImWchar> m_ranges;     // kept alive for the atlas
+    bool m_fromCache = false;
+};
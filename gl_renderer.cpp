@@ -0,0 +1,37 @@
+#include "gl_renderer.h"
+#include <GL/glew.h>
+#include <iostream>
+
+ImTextureID GLRenderer::CreateTexture(const unsigned char* rgba, int width, int height) {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    
+    // Set texture parameters
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, 
+                GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR) {
+        std::cerr << "[OpenGL] Error 0x" << std::hex << err << std::dec
+                  << " when creating a " << width << "x" << height << " texture" << std::endl;
+        glDeleteTextures(1, &texture);
+        return 0;
+    }
+    return static_cast<ImTextureID>(texture);
+}
+
+void GLRenderer::DestroyTexture(ImTextureID id) {
+    GLuint texture = static_cast<GLuint>(id);
+    glDeleteTextures(1, &texture);
+}
+
+size_t GLRenderer::TextureBytes(int width, int height) const {
+    return static_cast<size_t>(width) * height * 4 * 4 / 3;  // with mipmaps
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include "renderer.h"
+
+// Textures for the ImGui OpenGL3 backend. Needs a current GL context.
+class GLRenderer : public Renderer {
+public:
+    ImTextureID CreateTexture(const unsigned char* rgba, int width, int height) override;
+    void DestroyTexture(ImTextureID id) override;
+    size_t TextureBytes(int width, int height) const override;
+};
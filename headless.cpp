@@ -0,0 +1,89 @@
+#include "headless.h"
+#include "browser.h"
+#include "fonts.h"
+#include "renderer.h"
+#include "trace.h"
+#include "imgui.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+// Local paths become file:// URLs, which curl loads like any other.
+static std::string ToURL(const std::string& arg) {
+    if (arg.find("://") != std::string::npos) return arg;
+    char resolved[PATH_MAX];
+    if (realpath(arg.c_str(), resolved)) return std::string("file://") + resolved;
+    return arg;
+}
+
+static double Ms(int64_t at, int64_t since) {
+    return at ? (at - since) / 1000.0 : 0.0;
+}
+
+int RunHeadless(const HeadlessOptions& options) {
+    ImGui::CreateContext();
+    ImGuiIO& io = ImGui::GetIO();
+    io.IniFilename = nullptr;
+    io.DisplaySize = ImVec2(static_cast<float>(options.width), static_cast<float>(options.height));
+    FontManager fonts(io.Fonts);  // baked on the CPU, never uploaded
+
+    int exitCode = 0;
+    {
+        NullRenderer renderer;
+        Browser browser(renderer, options.network);
+        browser.SetFontManager(&fonts);
+        browser.Navigate(ToURL(options.url));
+
+        using Clock = std::chrono::steady_clock;
+        auto start = Clock::now();
+        auto last = start;
+        int frames = 0;
+        int vertices = 0;
+        while (!browser.PageLoaded()) {
+            auto now = Clock::now();
+            if (std::chrono::duration<double>(now - start).count() > options.timeoutSeconds) {
+                fprintf(stderr, "[Headless] Timed out after %.0f s\n", options.timeoutSeconds);
+                exitCode = 2;
+                break;
+            }
+            io.DeltaTime = std::max(1e-4f, std::chrono::duration<float>(now - last).count());
+            last = now;
+
+            fonts.Update();
+            ImGui::NewFrame();
+            browser.DrawUI();
+            ImGui::Render();
+            browser.OnFrameRendered(ImGui::GetDrawData());
+            vertices = ImGui::GetDrawData()->TotalVtxCount;
+            frames++;
+            // frames only matter when something arrived; don't spin on the network
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        const PageLoadTimings& t = browser.GetLoadTimings();
+        const ResourceLoader::Stats& stats = browser.GetLoaderStats();
+        int64_t t0 = t.navigationStart;
+        printf("url           %s\n", t.url.c_str());
+        printf("status        %ld%s\n", t.status, t.ok ? "" : " (failed)");
+        printf("document      %9.1f ms\n", Ms(t.documentReady, t0));
+        printf("first layout  %9.1f ms   parse %.2f ms, %d nodes, depth %d\n", Ms(t.firstRender, t0), t.parseMs,
+               t.domNodes, t.domDepth);
+        printf("complete      %9.1f ms   %d images, %d requests, %d transfers, %d coalesced\n",
+               Ms(t.complete, t0), t.images, stats.requests, stats.transfers, stats.coalesced);
+        printf("layout        %9.2f ms/frame, %d vertices, %d frames\n", t.layoutMs, vertices, frames);
+        if (!t.ok && exitCode == 0) exitCode = 1;
+
+        if (!options.tracePath.empty()) {
+            if (trace::WriteJSON(options.tracePath)) {
+                fprintf(stderr, "[Trace] Wrote %s\n", options.tracePath.c_str());
+            } else {
+                fprintf(stderr, "[Trace] Could not write %s\n", options.tracePath.c_str());
+            }
+        }
+    }
+    ImGui::DestroyContext();
+    return exitCode;
+}
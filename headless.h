@@ -0,0 +1,17 @@
+#pragma once
+#include <string>
+#include "loader.h"
+
+struct HeadlessOptions {
+    std::string url;            // URL, or a path to a local file
+    NetworkOptions network;
+    int width = 1280;           // layout viewport
+    int height = 800;
+    double timeoutSeconds = 30;
+    std::string tracePath;      // write a trace of the load here if set
+};
+
+// Loads one page with no window or GL context: fetch, parse, image decode and
+// ImGui layout all run as they would on screen, with textures replaced by
+// placeholders. Prints the load milestones; returns a process exit code.
+int RunHeadless(const HeadlessOptions& options);
@@ -0,0 +1,257 @@
+#include "history.h"
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include "encoding.h"
+#include "trace.h"
+
+static constexpr size_t kMaxIndexedText = 512 * 1024;
+static constexpr int64_t kReindexAfter = 24 * 60 * 60;
+
+std::string UserDataDir() {
+    std::string dir;
+    if (const char* xdg = getenv("XDG_DATA_HOME")) {
+        dir = xdg;
+    } else if (const char* home = getenv("HOME")) {
+#ifdef __APPLE__
+        dir = std::string(home) + "/Library/Application Support";
+#else
+        dir = std::string(home) + "/.local";
+        mkdir(dir.c_str(), 0755);
+        dir += "/share";
+#endif
+    } else {
+        return "";
+    }
+    mkdir(dir.c_str(), 0755);
+    dir += "/SimpleBrowser";
+    mkdir(dir.c_str(), 0755);
+    return dir;
+}
+
+// Tabs and line breaks would split a history.tsv line.
+static std::string LogField(std::string_view value) {
+    std::string out(value);
+    std::replace_if(out.begin(), out.end(), [](char c) { return c == '\t' || c == '\n' || c == '\r'; }, ' ');
+    return out;
+}
+
+// Takes the <title> and appends every other text node to text, up to kMaxIndexedText.
+static void CollectText(const HTMLNode& node, std::string& title, std::string& text) {
+    if (node.tag == Atom::Text) {
+        if (text.size() + node.text.size() >= kMaxIndexedText) return;
+        text += node.text;
+        text += ' ';
+        return;
+    }
+    if (node.tag == Atom::Title) {
+        if (title.empty() && !node.children.empty()) title = node.children[0].text;
+        return;
+    }
+    for (const HTMLNode& child : node.children) CollectText(child, title, text);
+}
+
+History::History(const std::string& dir) : m_dir(dir) {
+    if (!m_dir.empty()) {
+        mkdir(m_dir.c_str(), 0755);
+        Load();
+        if (m_logLines > 2 * m_entries.size() + 1000) Compact();
+        m_log = fopen((m_dir + "/history.tsv").c_str(), "a");
+        if (!m_log) std::cerr << "[History] Cannot write to " << m_dir << "; history is kept for this run only" << std::endl;
+    }
+    uint64_t stamp = LogStamp();
+    m_suggest = std::make_unique<SuggestIndex>(m_dir.empty() ? "" : m_dir + "/suggest.sbsx", stamp);
+    if (m_suggest->EntryCount() != m_entries.size()) m_suggest->Build(m_entries, stamp);
+    m_index = std::make_unique<TextIndex>(m_dir.empty() ? "" : m_dir + "/index",
+                                          [this](uint32_t doc) {
+                                              std::lock_guard<std::mutex> lock(m_docsMutex);
+                                              return m_byDoc.count(doc) != 0;
+                                          });
+    m_nextDoc = std::max(m_nextDoc, m_index->LastDoc() + 1);
+}
+
+History::~History() {
+    // saved for a quick start next time
+    if (!m_touched.empty()) m_suggest->Build(m_entries, LogStamp());
+    if (m_log) fclose(m_log);
+}
+
+// Identifies the state of history.tsv: it only ever grows, and compacting
+// it shrinks it.
+uint64_t History::LogStamp() const {
+    struct stat st;
+    if (!m_log || fstat(fileno(m_log), &st) != 0) return 0;
+    return static_cast<uint64_t>(st.st_size);
+}
+
+void History::Load() {
+    TRACE_SCOPE("history", "History::Load");
+    FILE* f = fopen((m_dir + "/history.tsv").c_str(), "r");
+    if (!f) return;
+    // lines: time, visits, doc, url, title; a later line for a URL replaces
+    // the earlier ones
+    char* line = nullptr;
+    size_t capacity = 0;
+    ssize_t length;
+    while ((length = getline(&line, &capacity, f)) > 0) {
+        m_logLines++;
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) line[--length] = '\0';
+        char* fields[5];
+        int count = 0;
+        for (char* p = line; count < 5;) {
+            fields[count++] = p;
+            if (count == 5 || !(p = strchr(p, '\t'))) break;
+            *p++ = '\0';
+        }
+        if (count < 4 || !*fields[3]) continue;
+        HistoryEntry entry;
+        entry.lastVisit = strtoll(fields[0], nullptr, 10);
+        entry.visits = static_cast<uint32_t>(strtoul(fields[1], nullptr, 10));
+        entry.doc = static_cast<uint32_t>(strtoul(fields[2], nullptr, 10));
+        entry.url = fields[3];
+        if (count == 5) entry.title = fields[4];
+
+        m_nextDoc = std::max(m_nextDoc, entry.doc + 1);
+        auto [index, inserted] = m_byUrl.Insert(m_urls.Intern(entry.url));
+        if (inserted) {
+            index = m_entries.size();
+            m_entries.push_back(std::move(entry));
+        } else {
+            m_entries[index] = std::move(entry);
+        }
+    }
+    free(line);
+    fclose(f);
+    for (size_t i = 0; i < m_entries.size(); i++) {
+        if (m_entries[i].doc) m_byDoc[m_entries[i].doc] = i;
+    }
+    std::cout << "[History] " << m_entries.size() << " pages from " << m_dir << std::endl;
+}
+
+void History::Compact() {
+    std::string path = m_dir + "/history.tsv";
+    std::string tmp = path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "w");
+    if (!f) return;
+    m_log = f;
+    for (const HistoryEntry& entry : m_entries) Append(entry);
+    m_log = nullptr;
+    if (fclose(f) == 0 && rename(tmp.c_str(), path.c_str()) == 0) {
+        m_logLines = m_entries.size();
+    } else {
+        unlink(tmp.c_str());
+    }
+}
+
+void History::Append(const HistoryEntry& entry) {
+    if (!m_log) return;
+    fprintf(m_log, "%lld\t%u\t%u\t%s\t%s\n", static_cast<long long>(entry.lastVisit), entry.visits, entry.doc,
+            LogField(entry.url).c_str(), LogField(entry.title).c_str());
+    fflush(m_log);
+    m_logLines++;
+}
+
+void History::AddVisit(const std::string& url, const HTMLNode& root) {
+    TRACE_SCOPE_ARG("history", "History::AddVisit", url.c_str());
+    if (url.empty() || url.compare(0, 6, "about:") == 0 || url.compare(0, 5, "data:") == 0) return;
+    int64_t now = time(nullptr);
+    auto [index, inserted] = m_byUrl.Insert(m_urls.Intern(url));
+    if (inserted) {
+        index = m_entries.size();
+        m_entries.emplace_back();
+        m_entries.back().url = url;
+    }
+    HistoryEntry& entry = m_entries[index];
+
+    std::string title, text;
+    CollectText(root, title, text);
+    if (!title.empty()) entry.title = title;
+    if (!entry.doc || now - entry.lastVisit >= kReindexAfter) {
+        // the title counts twice so pages named for a word rank above pages
+        // that merely mention it
+        {
+            std::lock_guard<std::mutex> lock(m_docsMutex);
+            m_byDoc.erase(entry.doc);
+            entry.doc = m_nextDoc++;
+            m_byDoc[entry.doc] = index;
+        }
+        m_index->Add(entry.doc, title + ' ' + title + ' ' + text);
+    }
+    entry.lastVisit = now;
+    entry.visits++;
+    Append(entry);
+    if (std::find(m_touched.begin(), m_touched.end(), index) == m_touched.end()) m_touched.push_back(index);
+}
+
+// Visits weighted by age of the last one, after Firefox's frecency buckets.
+static float Frecency(const HistoryEntry& entry, int64_t now) {
+    int64_t days = (now - entry.lastVisit) / (24 * 60 * 60);
+    float weight = days < 4 ? 100 : days < 14 ? 70 : days < 31 ? 50 : days < 90 ? 30 : 10;
+    return weight * entry.visits;
+}
+
+std::vector<const HistoryEntry*> History::Suggest(std::string_view typed, size_t limit) const {
+    std::vector<const HistoryEntry*> suggestions;
+    while (!typed.empty() && typed.front() == ' ') typed.remove_prefix(1);
+    std::string query = SuggestIndex::URLKey(typed);
+    std::vector<std::string_view> words;
+    for (size_t at = 0; at < query.size();) {
+        size_t end = std::min(query.find(' ', at), query.size());
+        if (end > at) words.push_back(std::string_view(query).substr(at, end - at));
+        at = end + 1;
+    }
+    if (words.empty() || limit == 0) return suggestions;
+
+    // (entry << 1 | matched the start of the URL), from the table and from
+    // entries that changed after it was built
+    std::vector<uint32_t> found;
+    m_suggest->Find(words[0], found);
+    for (size_t i : m_touched) {
+        if (int match = SuggestIndex::Match(m_entries[i], words[0])) found.push_back(static_cast<uint32_t>(i << 1 | (match == 2)));
+    }
+    // best match per entry, then one candidate each
+    std::vector<uint8_t> best(m_entries.size(), 0);
+    for (uint32_t f : found) best[f >> 1] = std::max<uint8_t>(best[f >> 1], 1 + (f & 1));
+    int64_t now = time(nullptr);
+    std::vector<std::pair<float, uint32_t>> ranked;
+    for (uint32_t f : found) {
+        uint32_t i = f >> 1;
+        if (!best[i]) continue;
+        // typing the start of an address is a stronger hint than a word of it
+        ranked.push_back({Frecency(m_entries[i], now) * best[i], i});
+        best[i] = 0;
+    }
+
+    // the best first; the other words are only checked on those
+    auto lower = [](const auto& a, const auto& b) { return a.first < b.first; };
+    std::make_heap(ranked.begin(), ranked.end(), lower);
+    std::string haystack;
+    while (!ranked.empty() && suggestions.size() < limit) {
+        std::pop_heap(ranked.begin(), ranked.end(), lower);
+        const HistoryEntry& entry = m_entries[ranked.back().second];
+        ranked.pop_back();
+        if (words.size() > 1) {
+            haystack = entry.title + ' ' + SuggestIndex::URLKey(entry.url);
+            FoldCase(haystack.data(), haystack.size(), &haystack[0]);
+            bool all = true;
+            for (size_t w = 1; w < words.size() && all; w++) all = haystack.find(words[w]) != std::string::npos;
+            if (!all) continue;
+        }
+        suggestions.push_back(&entry);
+    }
+    return suggestions;
+}
+
+std::vector<History::Result> History::Search(std::string_view query, size_t limit) const {
+    TRACE_SCOPE("history", "History::Search");
+    std::vector<Result> results;
+    for (const TextIndex::Hit& hit : m_index->Search(query, limit)) {
+        auto it = m_byDoc.find(hit.doc);
+        if (it != m_byDoc.end()) results.push_back({&m_entries[it->second], hit.score});
+    }
+    return results;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "flat_map.h"
+#include "html_parser.h"
+#include "suggest_index.h"
+#include "text_index.h"
+#include "url.h"
+
+struct HistoryEntry {
+    std::string url;
+    std::string title;
+    int64_t lastVisit = 0;  // unix seconds
+    uint32_t visits = 0;
+    uint32_t doc = 0;       // the page's text in the index; 0 if never indexed
+};
+
+// "$XDG_DATA_HOME/SimpleBrowser", "~/.local/share/SimpleBrowser" or
+// "~/Library/Application Support/SimpleBrowser", created if missing; "" if
+// there is no home directory.
+std::string UserDataDir();
+
+// Every page visited, kept across runs. Visits are appended to history.tsv
+// in dir, which is rewritten without superseded lines when it grows; the
+// text of each page goes into a TextIndex under dir/index so history can be
+// searched by content.
+class History {
+public:
+    // An empty dir keeps history for this run only.
+    explicit History(const std::string& dir);
+    ~History();
+    History(const History&) = delete;
+    History& operator=(const History&) = delete;
+
+    // Records a visit to url, whose parsed page is root. The page text is
+    // indexed on the first visit and again once a day at most, in the
+    // background.
+    void AddVisit(const std::string& url, const HTMLNode& root);
+
+    struct Result {
+        const HistoryEntry* entry;
+        float score;
+    };
+    // Visited pages whose title or text holds every word of query, best
+    // first. Pointers stay valid until the next AddVisit.
+    std::vector<Result> Search(std::string_view query, size_t limit) const;
+
+    // URL bar completions for typed text, best first: pages whose URL or a
+    // word of whose title or URL starts with the first word typed, and that
+    // contain the other words, ranked by frecency (visit count weighted by
+    // how recent the last visit was). Pointers stay valid until the next
+    // AddVisit.
+    std::vector<const HistoryEntry*> Suggest(std::string_view typed, size_t limit) const;
+
+    const std::vector<HistoryEntry>& Entries() const { return m_entries; }
+
+private:
+    void Load();
+    void Compact();
+    void Append(const HistoryEntry& entry);
+    uint64_t LogStamp() const;
+
+    std::string m_dir;
+    std::vector<HistoryEntry> m_entries;
+    URLTable m_urls;
+    FlatMap<size_t> m_byUrl;  // URLId in m_urls -> entry
+    std::unordered_map<uint32_t, size_t> m_byDoc;  // current doc of each entry
+    mutable std::mutex m_docsMutex;  // m_byDoc: the index thread reads it, this thread writes it
+    FILE* m_log = nullptr;
+    size_t m_logLines = 0;
+    uint32_t m_nextDoc = 1;
+    std::unique_ptr<SuggestIndex> m_suggest;
+    std::vector<size_t> m_touched;  // entries visited since m_suggest was built
+    std::unique_ptr<TextIndex> m_index;  // last: its live filter reads m_byDoc
+};
@@ -0,0 +1,369 @@
+#include "html_parser.h"
+#include "entities.h"
+#include "simd.h"
+#include <algorithm>
+#include <cstring>
+
+class HTMLAttributePool {
+public:
+    // Copies count attributes into one contiguous span.
+    const HTMLAttribute* AddSpan(const HTMLAttribute* attrs, size_t count) {
+        HTMLAttribute* span = Carve(m_spans, m_spanUsed, m_spanCapacity, count, kSpanBlock);
+        std::copy(attrs, attrs + count, span);
+        return span;
+    }
+
+    // Copies a value and NUL-terminates it.
+    const char* AddValue(const char* data, size_t size) {
+        char* value = Carve(m_values, m_valueUsed, m_valueCapacity, size + 1, kValueBlock);
+        memcpy(value, data, size);
+        value[size] = '\0';
+        return value;
+    }
+
+private:
+    static const size_t kSpanBlock = 256;     // attributes
+    static const size_t kValueBlock = 16384;  // bytes
+
+    // Takes count elements from the current block, or from a fresh one. An
+    // oversized request gets a block of its own so the current one stays open.
+    template <typename T>
+    static T* Carve(std::vector<std::unique_ptr<T[]>>& blocks, size_t& used, size_t& capacity,
+                    size_t count, size_t blockSize) {
+        if (count > blockSize) {
+            blocks.insert(blocks.begin(), std::unique_ptr<T[]>(new T[count]));
+            return blocks.front().get();
+        }
+        if (blocks.empty() || used + count > capacity) {
+            blocks.emplace_back(new T[blockSize]);
+            used = 0;
+            capacity = blockSize;
+        }
+        T* out = blocks.back().get() + used;
+        used += count;
+        return out;
+    }
+
+    std::vector<std::unique_ptr<HTMLAttribute[]>> m_spans;
+    size_t m_spanUsed = 0, m_spanCapacity = 0;
+    std::vector<std::unique_ptr<char[]>> m_values;
+    size_t m_valueUsed = 0, m_valueCapacity = 0;
+};
+
+// '<' only opens markup when a tag name, end tag, comment or declaration
+// follows; "a < b" is text.
+static bool IsMarkupStart(const std::string& html, size_t pos) {
+    if (pos + 1 >= html.size()) return false;
+    char c = html[pos + 1];
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '/' || c == '!' || c == '?';
+}
+
+// HTML attribute name characters: anything but whitespace, controls, quotes,
+// '<', '/', '>' and '='. Junk from broken markup is dropped rather than
+// interned, so it cannot fill the process-wide atom pool.
+static bool IsAttributeName(const char* name, size_t length) {
+    if (length == 0) return false;
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = static_cast<unsigned char>(name[i]);
+        if (c <= ' ' || c == 0x7F || c == '"' || c == '\'' || c == '<' || c == '/' || c == '>' || c == '=') return false;
+    }
+    return true;
+}
+
+// Index just past the first "<close[0]><close[1]>...>" style terminator at
+// or after from: the pair is found with FindPair, the rest checked here.
+static size_t SkipPast(const std::string& html, size_t from, const char* close) {
+    const char* data = html.data();
+    const char* end = data + html.size();
+    size_t length = strlen(close);
+    for (const char* p = FindPair(data + from, end, close[0], close[1]); p != end;
+         p = FindPair(p + 1, end, close[0], close[1])) {
+        if (static_cast<size_t>(end - p) >= length && memcmp(p, close, length) == 0) return p - data + length;
+    }
+    return html.size();
+}
+
+// Index of the "</name" that ends a raw-text element such as <script>, or
+// the end of input. Nothing before it is markup, whatever it looks like.
+static size_t FindRawTextEnd(const std::string& html, size_t from, Atom name) {
+    const char* tag = AtomName(name);
+    size_t length = strlen(tag);
+    const char* data = html.data();
+    const char* end = data + html.size();
+    for (const char* p = FindPair(data + from, end, '<', '/'); p != end; p = FindPair(p + 1, end, '<', '/')) {
+        if (static_cast<size_t>(end - p) < length + 2 || LookupAtom(p + 2, length) != name) continue;
+        char after = p + 2 + length < end ? p[2 + length] : '>';
+        if (after == '>' || after == '/' || after == ' ' || after == '\t' || after == '\n' || after == '\r' ||
+            after == '\f') {
+            return p - data;
+        }
+    }
+    return html.size();
+}
+
+// Elements that never have content: a start tag is all there is.
+static bool IsVoid(Atom tag) {
+    switch (tag) {
+    case Atom::Area: case Atom::Base: case Atom::Br: case Atom::Col: case Atom::Embed: case Atom::Frame:
+    case Atom::Hr: case Atom::Img: case Atom::Input: case Atom::Link: case Atom::Meta: case Atom::Param:
+    case Atom::Source: case Atom::Track: case Atom::Wbr:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Start tags that end an open <p>.
+static bool ClosesParagraph(Atom tag) {
+    switch (tag) {
+    case Atom::Address: case Atom::Article: case Atom::Aside: case Atom::Blockquote: case Atom::Center:
+    case Atom::Details: case Atom::Dialog: case Atom::Div: case Atom::Dl: case Atom::Fieldset:
+    case Atom::Figcaption: case Atom::Figure: case Atom::Footer: case Atom::Form: case Atom::H1:
+    case Atom::H2: case Atom::H3: case Atom::H4: case Atom::H5: case Atom::H6: case Atom::Header:
+    case Atom::Hgroup: case Atom::Hr: case Atom::Main: case Atom::Menu: case Atom::Nav: case Atom::Ol:
+    case Atom::P: case Atom::Pre: case Atom::Search: case Atom::Section: case Atom::Table: case Atom::Ul:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool IsHeading(Atom tag) {
+    return tag == Atom::H1 || tag == Atom::H2 || tag == Atom::H3 || tag == Atom::H4 || tag == Atom::H5 ||
+           tag == Atom::H6;
+}
+
+static bool IsTablePart(Atom tag) {
+    return tag == Atom::Table || tag == Atom::Caption || tag == Atom::Colgroup || tag == Atom::Tbody ||
+           tag == Atom::Thead || tag == Atom::Tfoot || tag == Atom::Tr || tag == Atom::Td || tag == Atom::Th;
+}
+
+// Stack index of the innermost open element in targets, searching down from
+// the current node and giving up at the first one in boundaries. 0 (the
+// root, never a match) when there is none.
+static size_t FindOpen(const std::vector<HTMLNode*>& stack, std::initializer_list<Atom> targets,
+                       std::initializer_list<Atom> boundaries) {
+    for (size_t i = stack.size() - 1; i > 0; i--) {
+        Atom tag = stack[i]->tag;
+        for (Atom target : targets) {
+            if (tag == target) return i;
+        }
+        for (Atom boundary : boundaries) {
+            if (tag == boundary) return 0;
+        }
+    }
+    return 0;
+}
+
+// Past this, elements become siblings instead of nesting further, so
+// recursive walks of the tree stay within the stack.
+static const size_t kMaxDepth = 512;
+
+HTMLNode ParseHTML(const std::string& html, HTMLParseStats* stats) {
+    auto pool = std::make_shared<HTMLAttributePool>();
+    std::vector<HTMLAttribute> scratch;  // the current tag's attributes
+    std::string decoded;                 // an attribute value with references in it
+    HTMLNode root;
+    root.tag = Atom::Root;
+    root.pool = pool;
+    HTMLParseStats counts;
+    counts.nodes = 1;
+    std::vector<HTMLNode*> stack = {&root};
+    size_t pos = 0;
+
+    // Pops everything from index (inclusive) up, as the end tags the page
+    // left out would have. Only an end tag for the element at index makes
+    // that one close explicit.
+    auto closeFrom = [&](size_t index, bool byEndTag) {
+        if (index == 0) return;
+        counts.impliedEndTags += static_cast<int>(stack.size() - index - (byEndTag ? 1 : 0));
+        stack.resize(index);
+    };
+    
+    while (pos < html.size()) {
+        if (html[pos] == '<' && IsMarkupStart(html, pos)) {
+            // comments, doctypes, CDATA and processing instructions never show,
+            // so they never become nodes
+            if (html.compare(pos, 4, "<!--") == 0) {
+                pos = SkipPast(html, pos + 4, "-->");
+                continue;
+            }
+            if (html.compare(pos, 9, "<![CDATA[") == 0) {
+                pos = SkipPast(html, pos + 9, "]]>");
+                continue;
+            }
+            if (html[pos + 1] == '!' || html[pos + 1] == '?') {
+                size_t close = html.find('>', pos + 2);
+                pos = close == std::string::npos ? html.size() : close + 1;
+                continue;
+            }
+
+            size_t tag_start = pos + 1;
+            size_t tag_end = html.find('>', tag_start);
+            if (tag_end == std::string::npos) break;
+            
+            std::string tag_content = html.substr(tag_start, tag_end - tag_start);
+            pos = tag_end + 1;
+            
+            if (tag_content[0] == '/') {
+                size_t name_end = tag_content.find_first_of(" \t\n\r\f", 1);
+                Atom name = InternAtom(tag_content.data() + 1, std::min(name_end, tag_content.size()) - 1);
+                // an end tag closes its own element and whatever was left open
+                // inside it, but never reaches out of a table cell it did not open
+                size_t open = 0;
+                if (name == Atom::Table) open = FindOpen(stack, {Atom::Table}, {});
+                else if (IsTablePart(name)) open = FindOpen(stack, {name}, {Atom::Table});
+                else if (!IsVoid(name)) open = FindOpen(stack, {name}, {Atom::Td, Atom::Th, Atom::Caption, Atom::Table});
+                if (open) {
+                    closeFrom(open, true);
+                } else {
+                    counts.strayEndTags++;
+                }
+            } 
+            else {
+                bool self_closing = false;
+                if (!tag_content.empty() && tag_content.back() == '/') {
+                    self_closing = true;
+                    tag_content.pop_back();
+                }
+
+                HTMLNode node;
+                size_t space_pos = tag_content.find_first_of(" \t\n\r\f");
+                node.tag = InternAtom(tag_content.data(), std::min(space_pos, tag_content.size()));
+                
+                // Parse attributes
+                scratch.clear();
+                size_t attr_start = space_pos;
+                while (attr_start != std::string::npos) {
+                    attr_start = tag_content.find_first_not_of(" \t\n\r\f", attr_start);
+                    if (attr_start == std::string::npos) break;
+                    
+                    size_t eq_pos = tag_content.find('=', attr_start);
+                    if (eq_pos == std::string::npos) break;
+                    
+                    // the name is the last word before '=': "disabled class=" is
+                    // a valueless attribute, then class
+                    size_t name_end = tag_content.find_last_not_of(" \t\n\r\f", eq_pos - 1);
+                    if (name_end == std::string::npos || name_end < attr_start) name_end = attr_start;
+                    else name_end++;
+                    size_t name_start = tag_content.find_last_of(" \t\n\r\f", name_end - 1);
+                    name_start = name_start == std::string::npos || name_start < attr_start ? attr_start : name_start + 1;
+                    const char* name = tag_content.data() + name_start;
+                    Atom key = IsAttributeName(name, name_end - name_start) ? InternAtom(name, name_end - name_start)
+                                                                            : Atom::None;
+                    attr_start = std::min(tag_content.find_first_not_of(" \t\n\r\f", eq_pos + 1), tag_content.size());
+                    
+                    if (attr_start < tag_content.size() && tag_content[attr_start] == '"') {
+                        size_t value_start = attr_start + 1;
+                        size_t value_end = tag_content.find('"', value_start);
+                        if (value_end != std::string::npos) {
+                            if (key != Atom::None && scratch.size() < UINT16_MAX) {
+                                const char* raw = tag_content.data() + value_start;
+                                size_t size = value_end - value_start;
+                                if (memchr(raw, '&', size)) {
+                                    decoded.assign(raw, size);
+                                    DecodeEntities(decoded, true);
+                                    raw = decoded.data();
+                                    size = decoded.size();
+                                }
+                                const char* value = pool->AddValue(raw, size);
+                                scratch.push_back({key, static_cast<uint32_t>(size), value});
+                            }
+                            attr_start = value_end + 1;
+                        }
+                    }
+                }
+                
+                if (!scratch.empty()) {
+                    node.attrs = pool->AddSpan(scratch.data(), scratch.size());
+                    node.attrCount = static_cast<uint16_t>(scratch.size());
+                }
+                // end tags HTML lets pages leave out
+                Atom tag = node.tag;
+                switch (tag) {
+                case Atom::Li:
+                    closeFrom(FindOpen(stack, {Atom::Li}, {Atom::Ul, Atom::Ol, Atom::Menu, Atom::Table, Atom::Td, Atom::Th}), false);
+                    break;
+                case Atom::Dd: case Atom::Dt:
+                    closeFrom(FindOpen(stack, {Atom::Dd, Atom::Dt}, {Atom::Dl, Atom::Table, Atom::Td, Atom::Th}), false);
+                    break;
+                case Atom::Tr:
+                    closeFrom(FindOpen(stack, {Atom::Tr}, {Atom::Table}), false);
+                    break;
+                case Atom::Td: case Atom::Th:
+                    closeFrom(FindOpen(stack, {Atom::Td, Atom::Th}, {Atom::Tr, Atom::Table}), false);
+                    break;
+                case Atom::Tbody: case Atom::Thead: case Atom::Tfoot:
+                    closeFrom(FindOpen(stack, {Atom::Tbody, Atom::Thead, Atom::Tfoot}, {Atom::Table}), false);
+                    break;
+                case Atom::Option:
+                    closeFrom(FindOpen(stack, {Atom::Option}, {Atom::Select, Atom::Datalist, Atom::Optgroup}), false);
+                    break;
+                case Atom::Optgroup:
+                    closeFrom(FindOpen(stack, {Atom::Option}, {Atom::Select, Atom::Datalist}), false);
+                    closeFrom(FindOpen(stack, {Atom::Optgroup}, {Atom::Select}), false);
+                    break;
+                default:
+                    break;
+                }
+                if (ClosesParagraph(tag)) {
+                    closeFrom(FindOpen(stack, {Atom::P}, {Atom::Html, Atom::Table, Atom::Td, Atom::Th, Atom::Caption,
+                                                         Atom::Button, Atom::Template, Atom::Object}), false);
+                }
+                if (IsHeading(tag) && IsHeading(stack.back()->tag)) closeFrom(stack.size() - 1, false);
+
+                stack.back()->children.push_back(std::move(node));
+                counts.nodes++;
+                HTMLNode* element = &stack.back()->children.back();
+                bool container = !self_closing && !IsVoid(tag);
+                if (container && stack.size() <= kMaxDepth) {
+                    stack.push_back(element);
+                    counts.maxDepth = std::max(counts.maxDepth, static_cast<int>(stack.size()) - 1);
+                }
+
+                // Raw text runs to its own end tag. Script and style bodies are
+                // dropped outright; title and textarea keep theirs as one text node.
+                bool rawText = tag == Atom::Script || tag == Atom::Style || tag == Atom::Iframe;
+                bool escapableRawText = tag == Atom::Title || tag == Atom::Textarea;
+                if (container && (rawText || escapableRawText)) {
+                    size_t close = FindRawTextEnd(html, pos, tag);
+                    if (escapableRawText && close > pos) {
+                        HTMLNode text;
+                        text.tag = Atom::Text;
+                        text.text = html.substr(pos, close - pos);
+                        text.text.erase(text.text.find_last_not_of(" \n\r\t") + 1);
+                        text.text.erase(0, text.text.find_first_not_of(" \n\r\t"));
+                        DecodeEntities(text.text);
+                        element->children.push_back(std::move(text));
+                        counts.nodes++;
+                    }
+                    pos = close;
+                }
+            }
+        } 
+        else {
+            size_t text_end = html.find('<', pos);
+            while (text_end != std::string::npos && !IsMarkupStart(html, text_end)) {
+                text_end = html.find('<', text_end + 1);
+            }
+            if (text_end == std::string::npos) text_end = html.size();
+            
+            std::string text = html.substr(pos, text_end - pos);
+            text.erase(text.find_last_not_of(" \n\r\t") + 1);
+            text.erase(0, text.find_first_not_of(" \n\r\t"));
+            DecodeEntities(text);
+            
+            // PREVENT EMPTY TEXT NODES
+            if (!text.empty()) {
+                HTMLNode node;
+                node.tag = Atom::Text;
+                node.text = std::move(text);
+                stack.back()->children.push_back(std::move(node));
+                counts.nodes++;
+            }
+            pos = text_end;
+        }
+    }
+    if (stats) *stats = counts;
+    return root;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "atoms.h"
+
+// One name="value" pair. The value lives in the document's attribute pool
+// and is NUL-terminated.
+struct HTMLAttribute {
+    Atom name = Atom::None;
+    uint32_t size = 0;
+    const char* data = nullptr;
+
+    std::string_view value() const { return std::string_view(data, size); }
+};
+
+// Backing store for every attribute of one parsed document: spans of
+// HTMLAttribute and the value bytes they point at, carved from blocks that
+// never move.
+class HTMLAttributePool;
+
+struct HTMLNode {
+    Atom tag = Atom::None;
+    uint16_t attrCount = 0;
+    uint32_t resource = 0;  // for the embedder: what the node loads, 0 for nothing
+    const HTMLAttribute* attrs = nullptr;  // attrCount entries in the pool
+    std::string text;
+    std::vector<HTMLNode> children;
+    std::shared_ptr<const HTMLAttributePool> pool;  // set on the root only
+
+    // First attribute with this name, or nullptr. Most elements carry fewer
+    // than five, so a linear scan beats any index.
+    const HTMLAttribute* FindAttr(Atom name) const {
+        for (uint16_t i = 0; i < attrCount; i++) {
+            if (attrs[i].name == name) return &attrs[i];
+        }
+        return nullptr;
+    }
+};
+
+struct HTMLParseStats {
+    int nodes = 0;           // including the root
+    int maxDepth = 0;        // of elements below the root
+    int impliedEndTags = 0;  // elements closed without their end tag
+    int strayEndTags = 0;    // end tags that matched nothing open
+};
+
+// Builds a tree from html. Tag and attribute names are interned, so they
+// match case-insensitively. Text nodes get the tag Atom::Text and are trimmed;
+// whitespace-only runs are dropped. Character references in text and quoted
+// attribute values are decoded. Comments, doctypes, CDATA and the bodies of
+// <script>, <style> and <iframe> are skipped without creating nodes; <title>
+// and <textarea> hold their content as a single text node.
+//
+// Tree construction follows the HTML rules that matter for shape: void
+// elements (<img>, <br>, <meta>, ...) never take children, end tags close the
+// matching open element, and the end tags pages may omit (</p>, </li>,
+// </td>, </tr>, </option>, ...) are implied. Nesting stops at 512 levels.
+//
+// Attributes of every node point into the root's pool, so the root must
+// outlive any node taken from the tree.
+HTMLNode ParseHTML(const std::string& html, HTMLParseStats* stats = nullptr);
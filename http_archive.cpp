@@ -0,0 +1,119 @@
+#include "http_archive.h"
+#include <cinttypes>
+#include <cstring>
+#include <strings.h>
+#include <iostream>
+
+static const char kMagic[] = "SBAR 1\n";
+
+std::string ArchiveEntry::Header(const char* name) const {
+    size_t length = strlen(name);
+    for (size_t line = 0; line < headers.size();) {
+        size_t end = headers.find('\n', line);
+        if (end == std::string::npos) end = headers.size();
+        if (end - line > length && headers[line + length] == ':' &&
+            strncasecmp(headers.data() + line, name, length) == 0) {
+            size_t begin = headers.find_first_not_of(" \t", line + length + 1);
+            size_t last = headers.find_last_not_of(" \t\r", end - 1);
+            if (begin == std::string::npos || begin > last || last >= end) return std::string();
+            return headers.substr(begin, last + 1 - begin);
+        }
+        line = end + 1;
+    }
+    return std::string();
+}
+
+static bool ReadLine(FILE* f, std::string& out) {
+    out.clear();
+    int c;
+    while ((c = fgetc(f)) != EOF && c != '\n') out.push_back(static_cast<char>(c));
+    return c != EOF || !out.empty();
+}
+
+static bool ReadBytes(FILE* f, size_t size, std::string& out) {
+    out.resize(size);
+    return size == 0 || fread(&out[0], 1, size, f) == size;
+}
+
+bool HttpArchive::IsArchive(const std::string& path) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    char magic[sizeof(kMagic)] = {};
+    bool match = fgets(magic, sizeof(magic), f) && std::string(magic) == kMagic;
+    fclose(f);
+    return match;
+}
+
+bool HttpArchive::Load(const std::string& path) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) {
+        std::cerr << "[Archive] Cannot open " << path << std::endl;
+        return false;
+    }
+    char magic[sizeof(kMagic)] = {};
+    if (!fgets(magic, sizeof(magic), f) || std::string(magic) != kMagic) {
+        std::cerr << "[Archive] Not an archive: " << path << std::endl;
+        fclose(f);
+        return false;
+    }
+
+    bool ok = true;
+    std::string line;
+    while (ReadLine(f, line)) {
+        ArchiveEntry entry;
+        size_t headerBytes = 0, bodyBytes = 0, errorBytes = 0;
+        PhaseTimes& t = entry.timing;
+        int urlStart = 0;
+        if (sscanf(line.c_str(), "%ld %zu %zu %zu %" SCNd64 " %" SCNd64 " %" SCNd64 " %" SCNd64 " %" SCNd64 " %" SCNd64 " %n",
+                   &entry.status, &headerBytes, &bodyBytes, &errorBytes,
+                   &t.dns, &t.connect, &t.tls, &t.pretransfer, &t.firstByte, &t.total, &urlStart) < 10 ||
+            urlStart == 0) {
+            ok = false;
+            break;
+        }
+        entry.url = line.substr(urlStart);
+        if (!ReadBytes(f, headerBytes, entry.headers) || !ReadBytes(f, bodyBytes, entry.body) ||
+            !ReadBytes(f, errorBytes, entry.error) || fgetc(f) != '\n') {
+            ok = false;
+            break;
+        }
+        m_index[m_urls.Intern(entry.url)] = m_entries.size();
+        m_entries.push_back(std::move(entry));
+    }
+    fclose(f);
+    if (!ok) std::cerr << "[Archive] Truncated or corrupt entry in " << path << ", kept " << m_entries.size() << std::endl;
+    return true;
+}
+
+const ArchiveEntry* HttpArchive::Find(const std::string& url) const {
+    URLId id = m_urls.Find(url);
+    const size_t* index = id ? m_index.Find(id) : nullptr;
+    return index ? &m_entries[*index] : nullptr;
+}
+
+ArchiveWriter::~ArchiveWriter() {
+    if (m_file) fclose(m_file);
+}
+
+bool ArchiveWriter::Open(const std::string& path) {
+    m_file = fopen(path.c_str(), "wb");
+    if (!m_file) {
+        std::cerr << "[Archive] Cannot create " << path << std::endl;
+        return false;
+    }
+    fputs(kMagic, m_file);
+    return true;
+}
+
+void ArchiveWriter::Write(const ArchiveEntry& entry) {
+    if (!m_file) return;
+    const PhaseTimes& t = entry.timing;
+    fprintf(m_file, "%ld %zu %zu %zu %" PRId64 " %" PRId64 " %" PRId64 " %" PRId64 " %" PRId64 " %" PRId64 " %s\n",
+            entry.status, entry.headers.size(), entry.body.size(), entry.error.size(),
+            t.dns, t.connect, t.tls, t.pretransfer, t.firstByte, t.total, entry.url.c_str());
+    fwrite(entry.headers.data(), 1, entry.headers.size(), m_file);
+    fwrite(entry.body.data(), 1, entry.body.size(), m_file);
+    fwrite(entry.error.data(), 1, entry.error.size(), m_file);
+    fputc('\n', m_file);
+    fflush(m_file);
+}
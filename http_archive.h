@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "flat_map.h"
+#include "url.h"
+
+// Phase boundaries of a transfer in microseconds since it started, cumulative
+// the way curl reports them (each is >= the one before it).
+struct PhaseTimes {
+    int64_t dns = 0;
+    int64_t connect = 0;
+    int64_t tls = 0;          // 0 for plain HTTP
+    int64_t pretransfer = 0;  // request sent
+    int64_t firstByte = 0;
+    int64_t total = 0;
+};
+
+// One recorded response.
+struct ArchiveEntry {
+    std::string url;
+    long status = 0;
+    std::string headers;  // header block of the final response, as received
+    std::string body;
+    std::string error;    // transport failure; empty when a response arrived
+    PhaseTimes timing;
+
+    // Value of the named header (matched case-insensitively), trimmed, or
+    // empty if the response had none.
+    std::string Header(const char* name) const;
+};
+
+// A file of recorded responses, written while browsing with --record and
+// served back with --replay so page loads can be repeated without a network.
+//
+// Format: an "SBAR 1" line, then per entry one line
+//   <status> <headerBytes> <bodyBytes> <errorBytes> <dns> <connect> <tls> <pretransfer> <firstByte> <total> <url>
+// followed by the header, body and error bytes and a newline.
+class HttpArchive {
+public:
+    // True if path starts with the archive header.
+    static bool IsArchive(const std::string& path);
+
+    bool Load(const std::string& path);
+    // Last entry recorded for url, or nullptr. Safe from any thread once
+    // Load has returned.
+    const ArchiveEntry* Find(const std::string& url) const;
+    size_t Size() const { return m_entries.size(); }
+    const std::vector<ArchiveEntry>& Entries() const { return m_entries; }
+
+private:
+    std::vector<ArchiveEntry> m_entries;
+    URLTable m_urls;
+    FlatMap<size_t> m_index;  // URLId in m_urls -> entry
+};
+
+// Appends entries to an archive file as they complete, flushing each one so a
+// crashed session still leaves a usable archive.
+class ArchiveWriter {
+public:
+    ArchiveWriter() = default;
+    ~ArchiveWriter();
+    ArchiveWriter(const ArchiveWriter&) = delete;
+    ArchiveWriter& operator=(const ArchiveWriter&) = delete;
+
+    bool Open(const std::string& path);
+    bool IsOpen() const { return m_file != nullptr; }
+    void Write(const ArchiveEntry& entry);
+
+private:
+    FILE* m_file = nullptr;
+};
@@ -0,0 +1,614 @@
+#include "loader.h"
+#include "data_uri.h"
+#include "trace.h"
+#include <curl/curl.h>
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <unordered_set>
+
+// True, marking the job aborted, if a body of size bytes is over its limit.
+// The main thread may lift the limit meanwhile, so it only counts as aborted
+// if the limit checked is still the one in place.
+bool ResourceLoader::OverBodyLimit(Job& job, size_t size) {
+    size_t limit = job.maxBody;
+    while (limit != 0 && limit != kBodyAborted && size > limit) {
+        if (job.maxBody.compare_exchange_weak(limit, kBodyAborted)) return true;
+    }
+    return limit == kBodyAborted;
+}
+
+size_t ResourceLoader::WriteBody(void* contents, size_t size, size_t nmemb, void* userp) {
+    auto* job = static_cast<Job*>(userp);
+    RecvBuffer& body = job->response.body;
+    size_t n = size * nmemb;
+    if (body.Empty()) {
+        // headers of the final response are in by the first body byte
+        curl_off_t length = -1;
+        curl_easy_getinfo(job->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+        if (length > 0 && OverBodyLimit(*job, static_cast<size_t>(length))) return 0;
+        if (length > 0) body.Reserve(static_cast<size_t>(length));
+    }
+    // anything but n makes curl abort the transfer
+    if (OverBodyLimit(*job, body.Size() + n)) return 0;
+    body.Append((char*)contents, n);
+    return n;
+}
+
+size_t ResourceLoader::WriteHeader(char* data, size_t size, size_t nmemb, void* userp) {
+    auto* job = static_cast<Job*>(userp);
+    size_t n = size * nmemb;
+    // a redirect or 100 Continue is followed by a fresh header block
+    if (n >= 5 && memcmp(data, "HTTP/", 5) == 0) job->headers.clear();
+    job->headers.append(data, n);
+    return n;
+}
+
+// stb_image pulls chunked bodies through these instead of a flattened copy
+struct BodyCursor {
+    const RecvBuffer* body;
+    size_t pos;
+};
+
+static int BodyRead(void* user, char* data, int size) {
+    auto* cursor = static_cast<BodyCursor*>(user);
+    size_t n = cursor->body->Read(cursor->pos, data, static_cast<size_t>(size));
+    cursor->pos += n;
+    return static_cast<int>(n);
+}
+
+static void BodySkip(void* user, int n) {
+    auto* cursor = static_cast<BodyCursor*>(user);
+    if (n < 0 && static_cast<size_t>(-n) > cursor->pos) {
+        cursor->pos = 0;
+    } else {
+        cursor->pos = std::min(cursor->pos + n, cursor->body->Size());
+    }
+}
+
+static int BodyEof(void* user) {
+    auto* cursor = static_cast<BodyCursor*>(user);
+    return cursor->pos >= cursor->body->Size();
+}
+
+ResourceLoader::ResourceLoader(int decodeThreads, const NetworkOptions& network) : m_network(network) {
+    m_multi = curl_multi_init();
+    // every easy handle lives on the network thread, so no lock callbacks
+    m_share = curl_share_init();
+    curl_share_setopt((CURLSH*)m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt((CURLSH*)m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    if (m_network.mode == NetworkOptions::Mode::Record && m_recorder.Open(m_network.archivePath)) {
+        std::cerr << "[Archive] Recording to " << m_network.archivePath << std::endl;
+    }
+    if (m_network.mode == NetworkOptions::Mode::Replay) {
+        m_archive.Load(m_network.archivePath);
+        std::cerr << "[Archive] Replaying " << m_archive.Size() << " responses from "
+                  << m_network.archivePath << std::endl;
+        m_networkThread = std::thread(&ResourceLoader::ReplayThread, this);
+    } else {
+        m_networkThread = std::thread(&ResourceLoader::NetworkThread, this);
+    }
+    for (int i = 0; i < decodeThreads; i++) {
+        m_decodeThreads.emplace_back(&ResourceLoader::DecodeThread, this);
+    }
+}
+
+ResourceLoader::~ResourceLoader() {
+    m_quit = true;
+    curl_multi_wakeup((CURLM*)m_multi);
+    m_decodeCv.notify_all();
+    m_networkThread.join();
+    for (auto& t : m_decodeThreads) t.join();
+    curl_multi_cleanup((CURLM*)m_multi);
+    curl_share_cleanup((CURLSH*)m_share);
+}
+
+void ResourceLoader::LoadDocument(const std::string& url, const CancelToken& token, Callback onDone,
+                                  size_t maxBodySize) {
+    Submit(ResourceKind::Document, url, token, std::move(onDone), maxBodySize);
+}
+
+void ResourceLoader::LoadImage(const std::string& url, const CancelToken& token, Callback onDone) {
+    m_stats.requests++;
+    Submit(ResourceKind::Image, url, token, std::move(onDone));
+}
+
+static std::string OriginOf(const std::string& url) {
+    size_t scheme = url.find("://");
+    if (scheme == std::string::npos) return url;
+    return url.substr(0, url.find('/', scheme + 3));
+}
+
+void ResourceLoader::Preconnect(const std::string& url, const CancelToken& token, Callback onDone) {
+    Submit(ResourceKind::Preconnect, OriginOf(url) + "/", token, std::move(onDone));
+}
+
+void ResourceLoader::Submit(ResourceKind kind, const std::string& url, const CancelToken& token, Callback onDone,
+                            size_t maxBodySize) {
+    std::string_view canonical = URLCacheKey(url);
+    // documents and images share the table but never each other's transfer
+    auto keyOf = [kind](URLId id) { return id << 2 | (static_cast<uint64_t>(kind) + 1); };
+    URLId id = m_urls.Find(canonical);
+    uint64_t key = keyOf(id);
+
+    std::vector<Waiter> inherited;
+    Request* inFlight = id ? m_requests.Find(key) : nullptr;
+    if (inFlight) {
+        // the transfer must now carry the larger of the two limits
+        Job& shared = *inFlight->job;
+        size_t limit = shared.maxBody;
+        size_t wanted = maxBodySize == 0 || limit == 0 ? 0 : std::max(limit, maxBodySize);
+        while (limit != kBodyAborted && limit != wanted && !shared.maxBody.compare_exchange_weak(limit, wanted)) {}
+        if (limit != kBodyAborted) {
+            // Same URL already in flight: share its transfer and decode
+            inFlight->waiters.push_back({token, std::move(onDone)});
+            m_stats.coalesced++;
+            AddLogRow(shared, RequestSource::Coalesced);
+            m_log.back().timing.queued = trace::NowUs();
+            return;
+        }
+        // cut short for a limit this request does not have: fetch again for
+        // everyone, and let the old transfer finish unheard
+        inherited = std::move(inFlight->waiters);
+        m_requests.Erase(key);  // its reference to id passes to the new request
+    } else {
+        id = m_urls.Intern(canonical);
+        key = keyOf(id);
+    }
+
+    auto job = std::make_shared<Job>();
+    job->kind = kind;
+    job->id = m_nextJobId++;
+    job->url = id;
+    job->key = key;
+    job->maxBody = maxBodySize;
+    job->response.url = canonical;
+    job->response.timing.queued = trace::NowUs();
+
+    Request& request = m_requests[key];
+    request.job = job;
+    request.waiters = std::move(inherited);
+    request.waiters.push_back({token, std::move(onDone)});
+
+    if (kind == ResourceKind::Image && IsDataURI(canonical)) {
+        // No network stack involved: the payload is decoded with the pixels
+        job->inlineData = true;
+        m_stats.inlined++;
+        AddLogRow(*job, RequestSource::Inline);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_decodeQueue.push_back(std::move(job));
+        m_decodeCv.notify_one();
+        return;
+    }
+    if (kind == ResourceKind::Image) m_stats.transfers++;
+    AddLogRow(*job, RequestSource::Network);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_submitted.push_back(std::move(job));
+    }
+    curl_multi_wakeup((CURLM*)m_multi);
+}
+
+void ResourceLoader::AddLogRow(const Job& job, RequestSource source) {
+    RequestRecord record;
+    record.jobId = job.id;
+    record.url = job.response.url;
+    record.kind = job.kind;
+    record.source = source;
+    record.timing.queued = job.response.timing.queued;
+    m_logIndex[job.id].push_back(m_log.size());
+    m_log.push_back(std::move(record));
+}
+
+void ResourceLoader::LogCacheHit(const std::string& url, ResourceKind kind, RequestSource source) {
+    RequestRecord record;
+    record.url = url;
+    record.kind = kind;
+    record.source = source;
+    record.timing.queued = record.timing.start = record.timing.end = trace::NowUs();
+    record.done = record.ok = true;
+    record.status = 200;
+    m_log.push_back(std::move(record));
+}
+
+void ResourceLoader::ResetStats() {
+    m_stats = Stats();
+    m_log.clear();
+    m_logIndex.clear();
+}
+
+void ResourceLoader::Cancel(const CancelToken& token) {
+    if (!token) return;
+    token->store(true);
+
+    m_requests.EraseIf([&](uint64_t, Request& request) {
+        auto& waiters = request.waiters;
+        waiters.erase(std::remove_if(waiters.begin(), waiters.end(),
+                                     [](const Waiter& w) { return w.token->load(); }),
+                      waiters.end());
+        if (!waiters.empty()) return false;
+        // nobody left to deliver to: let the worker threads drop it
+        request.job->cancelled = true;
+        m_stats.cancelled++;
+        m_urls.Release(request.job->url);
+        return true;
+    });
+    curl_multi_wakeup((CURLM*)m_multi);
+}
+
+void ResourceLoader::Poll() {
+    std::deque<std::shared_ptr<Job>> done;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        done.swap(m_completed);
+    }
+    for (auto& job : done) {
+        auto rows = m_logIndex.find(job->id);
+        if (rows != m_logIndex.end()) {
+            for (size_t row : rows->second) {
+                RequestRecord& record = m_log[row];
+                // coalesced rows keep their own queue time over the shared transfer
+                int64_t queued = record.timing.queued;
+                record.timing = job->response.timing;
+                record.timing.queued = queued;
+                if (record.source == RequestSource::Inline) {
+                    record.timing.start = queued;
+                    record.timing.end = trace::NowUs();
+                }
+                record.status = job->response.status;
+                record.ok = job->response.ok;
+                record.done = true;
+            }
+            m_logIndex.erase(rows);
+        }
+
+        // a cancelled job may have been replaced by a fresh request
+        Request* pending = m_requests.Find(job->key);
+        if (!pending || pending->job != job) continue;
+        // Detach first so callbacks may issue new requests
+        Request request = std::move(*pending);
+        m_requests.Erase(job->key);
+        m_urls.Release(job->url);
+
+        for (auto& waiter : request.waiters) {
+            if (*waiter.token) continue;
+            waiter.onDone(job->response);
+        }
+    }
+}
+
+int ResourceLoader::DecodeBacklog() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return static_cast<int>(m_decodeQueue.size());
+}
+
+void ResourceLoader::Finish(std::shared_ptr<Job> job) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_completed.push_back(std::move(job));
+}
+
+static const char* kKindNames[] = {"document", "image", "preconnect"};
+
+static PhaseTimes CurlPhaseTimes(CURL* curl) {
+    PhaseTimes p;
+    curl_off_t value = 0;
+    curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &value);
+    p.dns = value;
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &value);
+    p.connect = value;
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &value);
+    p.tls = value;
+    curl_easy_getinfo(curl, CURLINFO_PRETRANSFER_TIME_T, &value);
+    p.pretransfer = value;
+    curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &value);
+    p.firstByte = value;
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &value);
+    p.total = value;
+    return p;
+}
+
+// Converts cumulative phase times into absolute timestamps and puts the
+// transfer on the trace timeline.
+static void RecordTiming(const PhaseTimes& p, uint64_t id, ResourceKind kind, Response& response) {
+    TransferTiming& t = response.timing;
+    t.dnsEnd = t.start + p.dns;
+    t.connectEnd = t.start + std::max(p.connect, p.dns);
+    t.tlsEnd = p.tls > 0 ? t.start + p.tls : t.connectEnd;
+    t.requestSent = std::max(t.tlsEnd, t.start + p.pretransfer);
+    t.firstByte = std::max(t.requestSent, t.start + p.firstByte);
+    t.end = std::max(t.firstByte, t.start + p.total);
+    t.bytes = static_cast<int64_t>(response.body.Size());
+
+    if (!trace::Enabled()) return;
+    const char* url = response.url.c_str();
+    trace::Async("net", kKindNames[static_cast<int>(kind)], id, t.queued, t.end - t.queued, url);
+    if (t.start > t.queued) trace::Async("net", "queue", id, t.queued, t.start - t.queued);
+    if (t.dnsEnd > t.start) trace::Async("net", "dns", id, t.start, t.dnsEnd - t.start);
+    if (t.connectEnd > t.dnsEnd) trace::Async("net", "connect", id, t.dnsEnd, t.connectEnd - t.dnsEnd);
+    if (t.tlsEnd > t.connectEnd) trace::Async("net", "tls", id, t.connectEnd, t.tlsEnd - t.connectEnd);
+    if (t.firstByte > t.requestSent) trace::Async("net", "ttfb", id, t.requestSent, t.firstByte - t.requestSent);
+    if (t.end > t.firstByte) trace::Async("net", "download", id, t.firstByte, t.end - t.firstByte);
+}
+
+void ResourceLoader::NetworkThread() {
+    trace::SetThreadName("network");
+    CURLM* multi = (CURLM*)m_multi;
+    std::unordered_map<CURL*, std::shared_ptr<Job>> active;
+
+    while (!m_quit) {
+        std::deque<std::shared_ptr<Job>> submitted;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            submitted.swap(m_submitted);
+        }
+        for (auto& job : submitted) {
+            if (job->cancelled) continue;
+            CURL* curl = curl_easy_init();
+            if (!curl) {
+                job->response.error = "curl_easy_init failed";
+                Finish(job);
+                continue;
+            }
+            curl_easy_setopt(curl, CURLOPT_URL, job->response.url.c_str());
+            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteBody);
+            curl_easy_setopt(curl, CURLOPT_WRITEDATA, job.get());
+            job->curl = curl;
+            curl_easy_setopt(curl, CURLOPT_USERAGENT, "SimpleBrowser/1.0");
+            curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+            curl_easy_setopt(curl, CURLOPT_SHARE, (CURLSH*)m_share);
+            if (m_recorder.IsOpen()) {
+                curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, WriteHeader);
+                curl_easy_setopt(curl, CURLOPT_HEADERDATA, job.get());
+            }
+            if (job->kind == ResourceKind::Image) {
+                curl_easy_setopt(curl, CURLOPT_TIMEOUT, 5L);
+            } else if (job->kind == ResourceKind::Preconnect) {
+                // connect and handshake, then stop without sending a request
+                curl_easy_setopt(curl, CURLOPT_CONNECT_ONLY, 1L);
+                curl_easy_setopt(curl, CURLOPT_TIMEOUT, 5L);
+            }
+            job->response.timing.start = trace::NowUs();
+            curl_multi_add_handle(multi, curl);
+            active[curl] = job;
+        }
+
+        // Abort transfers whose navigation went away
+        for (auto it = active.begin(); it != active.end();) {
+            if (it->second->cancelled) {
+                curl_multi_remove_handle(multi, it->first);
+                curl_easy_cleanup(it->first);
+                it = active.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        int running = 0;
+        curl_multi_perform(multi, &running);
+
+        int queued = 0;
+        while (CURLMsg* msg = curl_multi_info_read(multi, &queued)) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            CURL* curl = msg->easy_handle;
+            std::shared_ptr<Job> job = active[curl];
+            active.erase(curl);
+            Response& response = job->response;
+
+            if (msg->data.result == CURLE_OK) {
+                curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response.status);
+                char* contentType = nullptr;
+                curl_easy_getinfo(curl, CURLINFO_CONTENT_TYPE, &contentType);
+                if (contentType) response.contentType = contentType;
+            } else if (job->maxBody == kBodyAborted) {
+                response.error = "body over the size limit";
+            } else {
+                response.error = curl_easy_strerror(msg->data.result);
+            }
+            PhaseTimes phases = CurlPhaseTimes(curl);
+            RecordTiming(phases, job->id, job->kind, response);
+            curl_multi_remove_handle(multi, curl);
+            curl_easy_cleanup(curl);
+
+            if (m_recorder.IsOpen() && job->kind != ResourceKind::Preconnect) {
+                ArchiveEntry entry;
+                entry.url = response.url;
+                entry.status = response.status;
+                entry.headers = std::move(job->headers);
+                entry.body.resize(response.body.Size());
+                response.body.Read(0, &entry.body[0], entry.body.size());
+                entry.error = response.error;
+                entry.timing = phases;
+                m_recorder.Write(entry);
+            }
+            Deliver(job);
+        }
+
+        curl_multi_poll(multi, nullptr, 0, 1000, nullptr);
+    }
+
+    for (auto& [curl, job] : active) {
+        curl_multi_remove_handle(multi, curl);
+        curl_easy_cleanup(curl);
+    }
+}
+
+void ResourceLoader::Deliver(std::shared_ptr<Job> job) {
+    Response& response = job->response;
+    if (job->kind != ResourceKind::Image) {
+        response.ok = response.error.empty();
+        Finish(job);
+    } else if (response.status != 200) {  // ENSURE ONLY 200 OK
+        if (response.error.empty()) {
+            std::cerr << "[HTTP] Non-200 response: " << response.status << std::endl;
+        }
+        Finish(job);
+    } else if (response.body.Empty()) {
+        std::cerr << "[Image] Empty data received for " << response.url << std::endl;
+        Finish(job);
+    } else {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_decodeQueue.push_back(job);
+        m_decodeCv.notify_one();
+    }
+}
+
+PhaseTimes ResourceLoader::ReplayPhases(const ArchiveEntry& entry, bool https, bool warm) const {
+    PhaseTimes p = entry.timing;
+    int64_t download = p.total - p.firstByte;
+    if (m_network.bandwidth > 0) {
+        download = static_cast<int64_t>(entry.body.size()) * 1000000 / m_network.bandwidth;
+    }
+    if (m_network.latencyMs >= 0) {
+        // one round trip each for TCP, TLS and the request; a warm origin
+        // reuses its connection
+        int64_t rtt = static_cast<int64_t>(m_network.latencyMs) * 1000;
+        p.dns = 0;
+        p.connect = warm ? 0 : rtt;
+        p.tls = https && !warm ? p.connect + rtt : 0;
+        p.pretransfer = std::max(p.connect, p.tls);
+        p.firstByte = p.pretransfer + rtt;
+    }
+    p.total = p.firstByte + download;
+    return p;
+}
+
+void ResourceLoader::ReplayThread() {
+    trace::SetThreadName("network (replay)");
+    // No transfers are ever added; the multi handle is only a wakeable sleep.
+    CURLM* multi = (CURLM*)m_multi;
+    struct Scheduled {
+        int64_t due;
+        std::shared_ptr<Job> job;
+        const ArchiveEntry* entry;
+        PhaseTimes phases;
+    };
+    std::vector<Scheduled> pending;
+    std::unordered_set<std::string> warmOrigins;
+
+    while (!m_quit) {
+        std::deque<std::shared_ptr<Job>> submitted;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            submitted.swap(m_submitted);
+        }
+        for (auto& job : submitted) {
+            if (job->cancelled) continue;
+            Response& response = job->response;
+            response.timing.start = trace::NowUs();
+            std::string origin = OriginOf(response.url);
+            bool warm = !warmOrigins.insert(origin).second;
+            if (job->kind == ResourceKind::Preconnect) {
+                RecordTiming(PhaseTimes(), job->id, job->kind, response);
+                Deliver(job);
+                continue;
+            }
+            const ArchiveEntry* entry = m_archive.Find(response.url);
+            if (!entry) {
+                std::cerr << "[Archive] Not recorded: " << response.url << std::endl;
+                response.error = "not in archive";
+                RecordTiming(PhaseTimes(), job->id, job->kind, response);
+                Deliver(job);
+                continue;
+            }
+            PhaseTimes phases = ReplayPhases(*entry, origin.compare(0, 8, "https://") == 0, warm);
+            pending.push_back({response.timing.start + phases.total, job, entry, phases});
+        }
+
+        int64_t now = trace::NowUs();
+        int64_t next = now + 1000000;
+        for (size_t i = 0; i < pending.size();) {
+            Scheduled& s = pending[i];
+            if (!s.job->cancelled && s.due > now) {
+                next = std::min(next, s.due);
+                i++;
+                continue;
+            }
+            if (!s.job->cancelled) {
+                Response& response = s.job->response;
+                response.status = s.entry->status;
+                response.contentType = s.entry->Header("Content-Type");
+                response.error = s.entry->error;
+                if (OverBodyLimit(*s.job, s.entry->body.size())) {
+                    response.error = "body over the size limit";
+                } else {
+                    response.body.Reserve(s.entry->body.size());
+                    response.body.Append(s.entry->body.data(), s.entry->body.size());
+                }
+                RecordTiming(s.phases, s.job->id, s.job->kind, response);
+                Deliver(s.job);
+            }
+            s = std::move(pending.back());
+            pending.pop_back();
+        }
+
+        curl_multi_poll(multi, nullptr, 0, static_cast<int>((next - now + 999) / 1000), nullptr);
+    }
+}
+
+void ResourceLoader::DecodeThread() {
+    trace::SetThreadName("decode");
+    stbi_set_flip_vertically_on_load_thread(true);
+
+    while (true) {
+        std::shared_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_decodeCv.wait(lock, [&] { return m_quit || !m_decodeQueue.empty(); });
+            if (m_quit) return;
+            job = std::move(m_decodeQueue.front());
+            m_decodeQueue.pop_front();
+        }
+        if (job->cancelled) continue;
+
+        Response& response = job->response;
+        TRACE_SCOPE_ARG("image", "decode", response.url.c_str());
+        int width, height, channels;
+        unsigned char* data = nullptr;
+        if (job->inlineData) {
+            DataURI uri;
+            std::string bytes;
+            if (ParseDataURI(response.url, uri) && DecodeDataURI(uri, bytes)) {
+                data = stbi_load_from_memory(
+                    reinterpret_cast<const unsigned char*>(bytes.data()),
+                    static_cast<int>(bytes.size()),
+                    &width, &height, &channels, 4);
+            } else {
+                std::cerr << "[Image] Malformed data URI" << std::endl;
+                Finish(job);
+                continue;
+            }
+        } else if (response.body.Contiguous()) {
+            std::string_view bytes = response.body.View();
+            data = stbi_load_from_memory(
+                reinterpret_cast<const unsigned char*>(bytes.data()),
+                static_cast<int>(bytes.size()),
+                &width, &height, &channels,
+                4  // Force 4 channels (RGBA)
+            );
+        } else {
+            static const stbi_io_callbacks callbacks = {BodyRead, BodySkip, BodyEof};
+            BodyCursor cursor = {&response.body, 0};
+            data = stbi_load_from_callbacks(&callbacks, &cursor, &width, &height, &channels, 4);
+        }
+
+        if (!data) {
+            std::cerr << "[STB] Load failed: " << stbi_failure_reason()
+                      << " (" << response.url << ")" << std::endl;
+        } else if (width <= 0 || height <= 0) {
+            std::cerr << "[Image] Invalid dimensions: "
+                      << width << "x" << height << " for " << response.url << std::endl;
+            stbi_image_free(data);
+        } else {
+            response.image.pixels = {data, stbi_image_free};
+            response.image.width = width;
+            response.image.height = height;
+            response.ok = true;
+        }
+        // encoded bytes are no longer needed once decoded
+        response.body.Clear();
+        Finish(job);
+    }
+}
@@ -0,0 +1,201 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include "flat_map.h"
+#include "recv_buffer.h"
+#include "http_archive.h"
+#include "url.h"
+
+// RGBA pixels decoded off the main thread, ready for texture upload.
+struct DecodedImage {
+    std::unique_ptr<unsigned char, void(*)(void*)> pixels{nullptr, nullptr};
+    int width = 0;
+    int height = 0;
+};
+
+// Shared by every fetch a navigation starts; setting it abandons them all.
+using CancelToken = std::shared_ptr<std::atomic<bool>>;
+inline CancelToken MakeCancelToken() { return std::make_shared<std::atomic<bool>>(false); }
+
+// Phase boundaries of one transfer, in trace::NowUs() microseconds. Each
+// phase ends where the next begins; zero-length phases were skipped (e.g. a
+// reused connection has no connect or TLS time).
+struct TransferTiming {
+    int64_t queued = 0;       // request submitted
+    int64_t start = 0;        // handed to curl
+    int64_t dnsEnd = 0;
+    int64_t connectEnd = 0;
+    int64_t tlsEnd = 0;
+    int64_t requestSent = 0;
+    int64_t firstByte = 0;
+    int64_t end = 0;
+    int64_t bytes = 0;        // body size as received
+};
+
+enum class ResourceKind { Document, Image, Preconnect };
+
+// Where a request's bytes came from, for the network panel.
+enum class RequestSource {
+    Network,    // its own transfer
+    Coalesced,  // attached to another request's transfer
+    Inline,     // data: URI
+    Prefetch,   // served from the hover prefetch cache
+    Memory,     // already decoded and on the GPU
+};
+
+// One row of the per-page request log.
+struct RequestRecord {
+    uint64_t jobId = 0;
+    std::string url;
+    ResourceKind kind = ResourceKind::Document;
+    RequestSource source = RequestSource::Network;
+    TransferTiming timing;  // shared with the transfer when coalesced
+    long status = 0;
+    bool done = false;
+    bool ok = false;
+};
+
+// Where requests are served from. Record passes everything through to the
+// network and appends each response to archivePath; Replay never touches the
+// network and answers from the archive instead, over a simulated link.
+struct NetworkOptions {
+    enum class Mode { Live, Record, Replay };
+    Mode mode = Mode::Live;
+    std::string archivePath;
+    int latencyMs = -1;     // replay round trip; -1 keeps the recorded phase times
+    int64_t bandwidth = 0;  // replay bytes/second; 0 keeps the recorded download times
+};
+
+// What a finished request hands back. For images, `image` is only valid when
+// ok is set; documents carry the raw body whatever the HTTP status was. A
+// document callback may take the body with body.TakeString().
+struct Response {
+    std::string url;
+    long status = 0;
+    std::string contentType;  // as sent, parameters included
+    RecvBuffer body;
+    std::string error;
+    DecodedImage image;
+    TransferTiming timing;
+    bool ok = false;
+};
+
+// Fetches and decodes resources on background threads. Transfers run on a
+// single curl multi handle, decoding runs on a small worker pool, and results
+// are handed back on the main thread from Poll(). Requests for a URL that is
+// already in flight attach to the pending transfer instead of starting another.
+class ResourceLoader {
+public:
+    using Callback = std::function<void(Response& response)>;
+
+    struct Stats {
+        int requests = 0;   // LoadImage calls
+        int transfers = 0;  // network transfers actually started
+        int coalesced = 0;  // requests that attached to an in-flight transfer
+        int cancelled = 0;  // transfers or decodes abandoned by navigation
+        int inlined = 0;    // data: URIs decoded without touching the network
+    };
+
+    explicit ResourceLoader(int decodeThreads, const NetworkOptions& network = NetworkOptions());
+    ~ResourceLoader();
+
+    // A body over maxBodySize bytes (0: no limit) aborts the transfer as soon
+    // as its Content-Length or the bytes received give it away, and fails
+    // with an error. Another request for the same URL lifts the limit.
+    void LoadDocument(const std::string& url, const CancelToken& token, Callback onDone, size_t maxBodySize = 0);
+    void LoadImage(const std::string& url, const CancelToken& token, Callback onDone);
+    // Connects to url's origin without sending a request, leaving a warm DNS
+    // entry and TLS session behind for a later fetch from it.
+    void Preconnect(const std::string& url, const CancelToken& token, Callback onDone);
+
+    // Marks the token cancelled and aborts every transfer, decode and callback
+    // that no other live token is still waiting on.
+    void Cancel(const CancelToken& token);
+
+    // Main thread only: runs callbacks for finished requests.
+    void Poll();
+
+    bool Idle() const { return m_requests.Empty(); }
+    int PendingRequests() const { return static_cast<int>(m_requests.Size()); }
+    int DecodeBacklog();
+    const Stats& GetStats() const { return m_stats; }
+    // Requests since the last ResetStats(), in submission order.
+    const std::vector<RequestRecord>& GetLog() const { return m_log; }
+    // Notes a request the browser satisfied without the loader.
+    void LogCacheHit(const std::string& url, ResourceKind kind, RequestSource source);
+    // Starts a new page: clears the counters and the request log.
+    void ResetStats();
+
+private:
+    struct Job {
+        ResourceKind kind = ResourceKind::Image;
+        uint64_t id = 0;  // trace track
+        URLId url = 0;     // in m_urls, while the job is in m_requests
+        uint64_t key = 0;  // url and kind, in m_requests
+        Response response;
+        std::atomic<bool> cancelled{false};
+        // body limit, 0 for none; kBodyAborted once the transfer was cut short
+        std::atomic<size_t> maxBody{0};
+        bool inlineData = false;  // data: URI, goes straight to the decoder
+        void* curl = nullptr;  // CURL*, network thread only
+        std::string headers;   // record mode only
+    };
+
+    struct Waiter {
+        CancelToken token;
+        Callback onDone;
+    };
+
+    struct Request {
+        std::shared_ptr<Job> job;
+        std::vector<Waiter> waiters;
+    };
+
+    static size_t WriteBody(void* contents, size_t size, size_t nmemb, void* userp);
+    static size_t WriteHeader(char* data, size_t size, size_t nmemb, void* userp);
+    static constexpr size_t kBodyAborted = SIZE_MAX;
+    static bool OverBodyLimit(Job& job, size_t size);
+    void Submit(ResourceKind kind, const std::string& url, const CancelToken& token, Callback onDone,
+                size_t maxBodySize = 0);
+    void AddLogRow(const Job& job, RequestSource source);
+    void NetworkThread();
+    void ReplayThread();
+    PhaseTimes ReplayPhases(const ArchiveEntry& entry, bool https, bool warm) const;
+    // Routes a finished transfer to the decoder or straight to Poll().
+    void Deliver(std::shared_ptr<Job> job);
+    void DecodeThread();
+    void Finish(std::shared_ptr<Job> job);
+
+    // main thread only
+    URLTable m_urls;  // of the requests in flight
+    FlatMap<Request> m_requests;
+    Stats m_stats;
+    uint64_t m_nextJobId = 1;
+    std::vector<RequestRecord> m_log;
+    std::unordered_map<uint64_t, std::vector<size_t>> m_logIndex;  // job id -> rows
+
+    std::mutex m_mutex;
+    std::condition_variable m_decodeCv;
+    std::deque<std::shared_ptr<Job>> m_submitted;
+    std::deque<std::shared_ptr<Job>> m_decodeQueue;
+    std::deque<std::shared_ptr<Job>> m_completed;
+    std::atomic<bool> m_quit{false};
+
+    NetworkOptions m_network;
+    HttpArchive m_archive;     // replay
+    ArchiveWriter m_recorder;  // record, network thread only
+
+    void* m_multi = nullptr;  // CURLM*
+    void* m_share = nullptr;  // CURLSH*, TLS sessions reused across transfers
+    std::thread m_networkThread;
+    std::vector<std::thread> m_decodeThreads;
+};
@@ -1,14 +1,96 @@
 #include "browser.h"
+#include "fonts.h"
+#include "gl_renderer.h"
+#include "headless.h"
+#include "history.h"
+#include "batch.h"
+#include "trace.h"
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
+#include <GL/glew.h>
 #include <GLFW/glfw3.h>
+#include <algorithm>
+#include <cstring>
 
 static void glfw_error_callback(int error, const char* description) {
     fprintf(stderr, "Glfw Error %d: %s\n", error, description);
 }
 
-int main() {
+static void PrintUsage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s [options] [URL]\n"
+            "  --headless        load URL (or a local file) without a window, print timings\n"
+            "  --trace FILE      headless: write a page-load trace to FILE\n"
+            "  --batch FILE      process every URL in FILE (a list or a recorded archive)\n"
+            "  --concurrency N   batch: pages in flight at once (default 16)\n"
+            "  --dump KIND       batch: write 'text' or 'displaylist' per page\n"
+            "  --out DIR         batch: where dumps go (default .)\n"
+            "  --record FILE     save every response fetched to FILE\n"
+            "  --replay FILE     serve responses from FILE instead of the network\n"
+            "  --latency MS      replay over a link with this round-trip time\n"
+            "  --bandwidth KBPS  replay over a link with this throughput (kilobytes/s)\n",
+            argv0);
+}
+
+static bool ParseArgs(int argc, char** argv, HeadlessOptions& options, BatchOptions& batch, bool& headless) {
+    NetworkOptions& network = options.network;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--headless") {
+            headless = true;
+            continue;
+        }
+        if (arg.compare(0, 2, "--") != 0) {
+            options.url = arg;
+            continue;
+        }
+        if (i + 1 >= argc) return false;
+        const char* value = argv[++i];
+        if (arg == "--record") {
+            network.mode = NetworkOptions::Mode::Record;
+            network.archivePath = value;
+        } else if (arg == "--replay") {
+            network.mode = NetworkOptions::Mode::Replay;
+            network.archivePath = value;
+        } else if (arg == "--latency") {
+            network.latencyMs = atoi(value);
+        } else if (arg == "--bandwidth") {
+            network.bandwidth = static_cast<int64_t>(atof(value) * 1024);
+        } else if (arg == "--trace") {
+            options.tracePath = value;
+        } else if (arg == "--batch") {
+            batch.input = value;
+        } else if (arg == "--concurrency") {
+            batch.concurrency = std::max(1, atoi(value));
+        } else if (arg == "--dump") {
+            if (strcmp(value, "text") == 0) batch.dump = BatchDump::Text;
+            else if (strcmp(value, "displaylist") == 0) batch.dump = BatchDump::DisplayList;
+            else return false;
+        } else if (arg == "--out") {
+            batch.outDir = value;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    HeadlessOptions options;
+    options.url = "https://news.ycombinator.com";
+    BatchOptions batch;
+    bool headless = false;
+    if (!ParseArgs(argc, argv, options, batch, headless)) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+    if (!batch.input.empty()) {
+        batch.network = options.network;
+        return RunBatch(batch);
+    }
+    if (headless) return RunHeadless(options);
+
     glfwSetErrorCallback(glfw_error_callback);
     if (!glfwInit()) return 1;
 
@@ -38,57 +120,76 @@ int main() {
     glfwSwapInterval(1);
 
 
-    IMGUI_CHECKVERSION();
+    int64_t windowReady = trace::NowUs();
+
     // Setup Dear ImGui context
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
     ImGuiIO& io = ImGui::GetIO(); (void)io; // Single declaration here
 
     // Load fonts
-    io.Fonts->AddFontDefault();
-    ImFont* heading_font = io.Fonts->AddFontFromFileTTF(
-        "/System/Library/Fonts/Supplemental/Arial Bold.ttf", 
-        24.0f
-    );
-    ImFont* bold_font = io.Fonts->AddFontFromFileTTF(
-        "/System/Library/Fonts/Supplemental/Arial Bold.ttf", 
-        16.0f
-    );
-    ImFont* italic_font = io.Fonts->AddFontFromFileTTF(
-        "/System/Library/Fonts/Supplemental/Arial Italic.ttf", 
-        16.0f
-    );
+    FontManager fonts(io.Fonts);
+    int64_t fontsReady = trace::NowUs();
 
     // Setup Platform/Renderer backends
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init("#version 150");
 
-    Browser browser;
-
-    // Main loop
-    while (!glfwWindowShouldClose(window)) {
-        glfwPollEvents();
-
-        // Start the Dear ImGui frame
-        ImGui_ImplOpenGL3_NewFrame();
-        ImGui_ImplGlfw_NewFrame();
-        ImGui::NewFrame();
-
-        // Draw browser UI
-        browser.DrawUI();
-
-        // Rendering
-        ImGui::Render();
-        int display_w, display_h;
-        glfwGetFramebufferSize(window, &display_w, &display_h);
+    // the browser frees its textures on destruction, so it must go before the GL context
+    {
+        // replayed sessions are measurements, not browsing, and stay out of history
+        bool replaying = options.network.mode == NetworkOptions::Mode::Replay;
+        History history(replaying ? "" : UserDataDir());
+
+        GLRenderer renderer;
+        Browser browser(renderer, options.network);
+        browser.SetFontManager(&fonts);
+        browser.SetHistory(&history);
+        int64_t browserReady = trace::NowUs();
+        // the start page is requested once the shell is on screen
+        bool firstFrame = true;
+
+        // Main loop
+        while (!glfwWindowShouldClose(window)) {
+            glfwPollEvents();
+
+            // a page needed glyphs the atlas lacked
+            if (fonts.Update()) {
+                ImGui_ImplOpenGL3_DestroyFontsTexture();
+                ImGui_ImplOpenGL3_CreateFontsTexture();
+            }
+
+            // Start the Dear ImGui frame
+            ImGui_ImplOpenGL3_NewFrame();
+            ImGui_ImplGlfw_NewFrame();
+            ImGui::NewFrame();
+
+            // Draw browser UI
+            browser.DrawUI();
+
+            // Rendering
+            ImGui::Render();
+            browser.OnFrameRendered(ImGui::GetDrawData());
+            int display_w, display_h;
+            glfwGetFramebufferSize(window, &display_w, &display_h);
         
   
-        glViewport(0, 0, display_w, display_h);
-        glClearColor(0.45f, 0.55f, 0.60f, 1.00f);
-        glClear(GL_COLOR_BUFFER_BIT);
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-
-        glfwSwapBuffers(window);
+            glViewport(0, 0, display_w, display_h);
+            glClearColor(0.45f, 0.55f, 0.60f, 1.00f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+
+            glfwSwapBuffers(window);
+
+            if (firstFrame) {
+                firstFrame = false;
+                trace::Instant("startup", "first frame");
+                fprintf(stderr, "[Startup] First frame at %.1f ms (window %.1f, fonts %.1f%s, browser %.1f)\n",
+                        trace::NowUs() / 1000.0, windowReady / 1000.0, (fontsReady - windowReady) / 1000.0,
+                        fonts.LoadedFromCache() ? " cached" : "", (browserReady - fontsReady) / 1000.0);
+                browser.Navigate(options.url);
+            }
+        }
     }
 
     // Cleanup
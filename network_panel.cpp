@@ -0,0 +1,180 @@
+#include "network_panel.h"
+#include "trace.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include "imgui.h"
+
+namespace {
+
+struct Phase {
+    const char* name;
+    int64_t begin;
+    int64_t end;
+    ImU32 color;
+};
+
+int CollectPhases(const RequestRecord& r, int64_t now, Phase out[7]) {
+    const TransferTiming& t = r.timing;
+    int64_t end = r.done ? t.end : now;
+    if (r.source == RequestSource::Inline) {
+        out[0] = {"decode", t.queued, end, IM_COL32(200, 160, 60, 255)};
+        return 1;
+    }
+    if (!r.done || t.start == 0) {
+        out[0] = {"waiting", t.queued, end, IM_COL32(150, 150, 150, 255)};
+        return 1;
+    }
+    int n = 0;
+    out[n++] = {"queue", t.queued, t.start, IM_COL32(150, 150, 150, 255)};
+    out[n++] = {"dns", t.start, t.dnsEnd, IM_COL32(40, 170, 160, 255)};
+    out[n++] = {"connect", t.dnsEnd, t.connectEnd, IM_COL32(230, 140, 40, 255)};
+    out[n++] = {"tls", t.connectEnd, t.tlsEnd, IM_COL32(160, 80, 200, 255)};
+    out[n++] = {"request", t.tlsEnd, t.requestSent, IM_COL32(120, 120, 200, 255)};
+    out[n++] = {"ttfb", t.requestSent, t.firstByte, IM_COL32(60, 170, 60, 255)};
+    out[n++] = {"download", t.firstByte, t.end, IM_COL32(50, 110, 220, 255)};
+    return n;
+}
+
+const char* KindName(ResourceKind kind) {
+    switch (kind) {
+    case ResourceKind::Document: return "document";
+    case ResourceKind::Image: return "image";
+    case ResourceKind::Preconnect: return "preconnect";
+    }
+    return "";
+}
+
+const char* SourceName(RequestSource source) {
+    switch (source) {
+    case RequestSource::Network: return "miss";
+    case RequestSource::Coalesced: return "coalesced";
+    case RequestSource::Inline: return "inline";
+    case RequestSource::Prefetch: return "hit (prefetch)";
+    case RequestSource::Memory: return "hit (memory)";
+    }
+    return "";
+}
+
+void FormatBytes(char* buf, size_t size, int64_t bytes) {
+    if (bytes < 1024) snprintf(buf, size, "%lld B", static_cast<long long>(bytes));
+    else if (bytes < 1024 * 1024) snprintf(buf, size, "%.1f KiB", bytes / 1024.0);
+    else snprintf(buf, size, "%.2f MiB", bytes / (1024.0 * 1024.0));
+}
+
+}  // namespace
+
+void NetworkPanel::Draw(const std::vector<RequestRecord>& log) {
+    if (!visible) return;
+    ImGui::SetNextWindowSize(ImVec2(900, 400), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Network", &visible)) {
+        ImGui::End();
+        return;
+    }
+
+    int64_t now = trace::NowUs();
+    int64_t t0 = INT64_MAX, t1 = 0;
+    int64_t totalBytes = 0;
+    int transfers = 0;
+    // sweep for the peak number of overlapping transfers
+    std::vector<std::pair<int64_t, int>> edges;
+    for (const RequestRecord& r : log) {
+        t0 = std::min(t0, r.timing.queued);
+        t1 = std::max(t1, r.done ? r.timing.end : now);
+        if (r.source == RequestSource::Network) {
+            transfers++;
+            totalBytes += r.timing.bytes;
+            if (r.timing.start) {
+                edges.push_back({r.timing.start, 1});
+                edges.push_back({r.done ? r.timing.end : now, -1});
+            }
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    int concurrent = 0, peak = 0;
+    for (auto& edge : edges) {
+        concurrent += edge.second;
+        peak = std::max(peak, concurrent);
+    }
+    if (log.empty()) t0 = t1 = now;
+    double span = std::max<int64_t>(t1 - t0, 1);
+
+    char size[32];
+    FormatBytes(size, sizeof(size), totalBytes);
+    ImGui::Text("%d requests, %d transfers, %s, %.0f ms, peak %d concurrent",
+                static_cast<int>(log.size()), transfers, size, span / 1000.0, peak);
+
+    ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                            ImGuiTableFlags_Resizable | ImGuiTableFlags_ScrollY;
+    if (ImGui::BeginTable("requests", 7, flags)) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Name", ImGuiTableColumnFlags_WidthFixed, 260);
+        ImGui::TableSetupColumn("Type", ImGuiTableColumnFlags_WidthFixed, 70);
+        ImGui::TableSetupColumn("Status", ImGuiTableColumnFlags_WidthFixed, 45);
+        ImGui::TableSetupColumn("Cache", ImGuiTableColumnFlags_WidthFixed, 95);
+        ImGui::TableSetupColumn("Size", ImGuiTableColumnFlags_WidthFixed, 70);
+        ImGui::TableSetupColumn("Time", ImGuiTableColumnFlags_WidthFixed, 60);
+        ImGui::TableSetupColumn("Waterfall", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableHeadersRow();
+
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(log.size()));
+        while (clipper.Step()) {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+                const RequestRecord& r = log[i];
+                int64_t end = r.done ? r.timing.end : now;
+                ImGui::TableNextRow();
+
+                ImGui::TableNextColumn();
+                const char* name = r.url.c_str();
+                const char* last = strrchr(name, '/');
+                ImGui::TextUnformatted(r.source == RequestSource::Inline ? "data:" :
+                                       (last && last[1] ? last + 1 : name));
+                if (ImGui::IsItemHovered()) ImGui::SetTooltip("%.*s", 512, name);
+
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(KindName(r.kind));
+                ImGui::TableNextColumn();
+                if (!r.done) ImGui::TextDisabled("...");
+                else if (r.status) ImGui::Text("%ld", r.status);
+                else ImGui::TextDisabled(r.ok ? "-" : "fail");
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(SourceName(r.source));
+                ImGui::TableNextColumn();
+                FormatBytes(size, sizeof(size), r.timing.bytes);
+                ImGui::TextUnformatted(r.source == RequestSource::Network ? size : "-");
+                ImGui::TableNextColumn();
+                ImGui::Text("%.0f ms", (end - r.timing.queued) / 1000.0);
+
+                ImGui::TableNextColumn();
+                ImVec2 origin = ImGui::GetCursorScreenPos();
+                float width = ImGui::GetContentRegionAvail().x;
+                float height = ImGui::GetTextLineHeight();
+                ImDrawList* draw = ImGui::GetWindowDrawList();
+                Phase phases[7];
+                int count = CollectPhases(r, now, phases);
+                for (int p = 0; p < count; p++) {
+                    // a coalesced row starts where it attached to the transfer
+                    int64_t begin = std::max(phases[p].begin, r.timing.queued);
+                    if (phases[p].end <= begin) continue;
+                    float x0 = origin.x + static_cast<float>((begin - t0) / span) * width;
+                    float x1 = origin.x + static_cast<float>((phases[p].end - t0) / span) * width;
+                    draw->AddRectFilled(ImVec2(x0, origin.y + 2), ImVec2(std::max(x1, x0 + 1), origin.y + height - 2),
+                                        phases[p].color);
+                }
+                ImGui::Dummy(ImVec2(width, height));
+                if (ImGui::IsItemHovered()) {
+                    ImGui::BeginTooltip();
+                    for (int p = 0; p < count; p++) {
+                        if (phases[p].end > phases[p].begin) {
+                            ImGui::Text("%-9s %8.1f ms", phases[p].name, (phases[p].end - phases[p].begin) / 1000.0);
+                        }
+                    }
+                    ImGui::EndTooltip();
+                }
+            }
+        }
+        ImGui::EndTable();
+    }
+    ImGui::End();
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include <vector>
+#include "loader.h"
+
+// Per-request waterfall of everything the current page loaded: one row per
+// document/image request with its curl phase breakdown, size and where the
+// bytes came from. Toggled with F10.
+class NetworkPanel {
+public:
+    bool visible = false;
+
+    void Draw(const std::vector<RequestRecord>& log);
+};
@@ -0,0 +1,189 @@
+#include "page_render.h"
+#include <cfloat>
+#include <cstring>
+#include "find_in_page.h"
+#include "imgui_internal.h"
+
+// Paints the find matches of a text node whose text starts at pos. Lines
+// are split the way ImGui lays out wrapped text: at '\n', and at wrapWidth
+// when it is non-zero, with the blanks after a wrap dropped.
+static void DrawFindMatches(FindInPage& find, const HTMLNode& node, ImVec2 pos, float wrapWidth) {
+    ImFont* font = ImGui::GetFont();
+    const float size = ImGui::GetFontSize();
+    const float scale = size / font->FontSize;
+    const char* text = node.text.c_str();
+    const char* end = text + node.text.size();
+
+    const char* line = text;
+    const char* lineEnd = nullptr;
+    float y = pos.y;
+    auto endOfLine = [&] {
+        const char* hard = static_cast<const char*>(memchr(line, '\n', end - line));
+        if (!hard) hard = end;
+        if (wrapWidth <= 0.0f) return hard;
+        const char* wrap = font->CalcWordWrapPositionA(scale, line, hard, wrapWidth);
+        return wrap > line ? wrap : std::min(line + 1, hard);
+    };
+    auto nextLine = [&] {
+        line = lineEnd;
+        if (line < end && *line == '\n') {
+            line++;
+        } else {
+            while (line < end && (*line == ' ' || *line == '\t')) line++;
+        }
+        y += size;
+        lineEnd = endOfLine();
+    };
+    lineEnd = endOfLine();
+
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    find.ForEachMatch(node, [&](uint32_t begin, uint32_t stop, bool current) {
+        const char* from = text + begin;
+        const char* to = text + stop;
+        while (from < to && line < end) {
+            if (lineEnd <= from) {
+                nextLine();
+                continue;
+            }
+            const char* pieceFrom = std::max(from, line);
+            const char* pieceTo = std::min(to, lineEnd);
+            float x0 = pos.x + font->CalcTextSizeA(size, FLT_MAX, 0.0f, line, pieceFrom).x;
+            float x1 = x0 + font->CalcTextSizeA(size, FLT_MAX, 0.0f, pieceFrom, pieceTo).x;
+            drawList->AddRectFilled(ImVec2(x0, y), ImVec2(x1, y + size),
+                                    current ? IM_COL32(255, 150, 0, 140) : IM_COL32(255, 230, 0, 110));
+            if (current && find.ScrollPending()) {
+                ImVec2 window = ImGui::GetWindowPos();
+                ImGui::SetScrollFromPosY(y + size * 0.5f - window.y, 0.5f);
+                if (x1 - window.x > ImGui::GetWindowWidth() || x0 < window.x) {
+                    ImGui::SetScrollFromPosX(x0 - window.x, 0.5f);
+                }
+                find.ScrollDone();
+            }
+            if (pieceTo == to) break;
+            from = pieceTo;
+        }
+    });
+}
+
+static void RenderNode(const HTMLNode& node, const PageRenderHooks& hooks) {
+    switch (node.tag) {
+    case Atom::Text:
+        if (!node.text.empty()) {
+            // Render text nodes inline
+            ImGui::SameLine(0, 0);
+            ImGui::TextUnformatted(node.text.c_str());
+            if (hooks.find && (ImGui::IsItemVisible() || hooks.find->ScrollPending())) {
+                ImVec2 pos = ImGui::GetItemRectMin();
+                float wrapPos = ImGui::GetCurrentWindowRead()->DC.TextWrapPos;
+                DrawFindMatches(*hooks.find, node, pos, wrapPos >= 0.0f ? ImGui::CalcWrapWidthForPos(pos, wrapPos) : 0.0f);
+            }
+            ImGui::SameLine(0, 0);
+        }
+        return;
+    case Atom::P: {
+        ImGui::PushTextWrapPos();
+        bool firstChild = true;
+        for (const auto& child : node.children) {
+            if (!firstChild) ImGui::SameLine(0, 0);
+            RenderNode(child, hooks);
+            firstChild = false;
+        }
+        ImGui::PopTextWrapPos();
+        ImGui::NewLine();
+        return;
+    }
+    case Atom::H1:
+        ImGui::PushFont(ImGui::GetIO().Fonts->Fonts[1]);
+        // Render all children (including text nodes)
+        for (const auto& child : node.children) {
+            RenderNode(child, hooks);
+        }
+        ImGui::PopFont();
+        ImGui::Separator();
+        return;
+    case Atom::H2:
+        ImGui::PushFont(ImGui::GetIO().Fonts->Fonts[1]);
+        for (const auto& child : node.children) {
+            RenderNode(child, hooks);
+        }
+        ImGui::PopFont();
+        return;
+    case Atom::A: {
+        const HTMLAttribute* href = node.FindAttr(Atom::Href);
+        if (!href) break;
+        std::string linkText;
+        for (const auto& child : node.children) {
+            if (child.tag == Atom::Text) {
+                linkText += child.text;
+            }
+        }
+        if(!linkText.empty()) {
+            ImGui::PushID(href->data); // Unique ID based on URL
+            ImGui::PushStyleColor(ImGuiCol_Text, IM_COL32(0, 0, 255, 255));
+            ImVec2 textPos = ImGui::GetCursorScreenPos();
+            if (ImGui::Selectable(linkText.c_str())) {
+                if (hooks.onLinkClicked) hooks.onLinkClicked(href->value());
+            } else if (ImGui::IsItemHovered()) {
+                if (hooks.onLinkHovered) hooks.onLinkHovered(href->value());
+            }
+            // Add underline
+            ImVec2 min = ImGui::GetItemRectMin();
+            ImVec2 max = ImGui::GetItemRectMax();
+            ImGui::GetWindowDrawList()->AddLine(
+                ImVec2(min.x, max.y),
+                ImVec2(max.x, max.y),
+                IM_COL32(0, 0, 255, 255)
+            );
+            if (hooks.find && (ImGui::IsItemVisible() || hooks.find->ScrollPending())) {
+                for (const auto& child : node.children) {
+                    if (child.tag != Atom::Text) continue;
+                    DrawFindMatches(*hooks.find, child, textPos, 0.0f);
+                    textPos.x += ImGui::CalcTextSize(child.text.c_str(), child.text.c_str() + child.text.size()).x;
+                }
+            }
+            ImGui::PopStyleColor();
+            ImGui::PopID();
+        }
+        return;
+    }
+    case Atom::Img: {
+        const HTMLAttribute* src = node.FindAttr(Atom::Src);
+        if (!src) break;
+        PageImage tex;
+        if (hooks.findImage && hooks.findImage(node, tex)) {
+            ImGui::Image(
+                tex.id,
+                ImVec2(tex.width, tex.height),
+                ImVec2(0,0),
+                ImVec2(1,1),
+                ImVec4(1,1,1,1),
+                ImVec4(0,0,0,0)
+            );
+        } else {
+            ImGui::TextColored(ImVec4(1,0,0,1), "[Loading: %s]", src->data);
+        }
+        return;
+    }
+    case Atom::B:
+    case Atom::Strong:
+        ImGui::PushFont(ImGui::GetIO().Fonts->Fonts[2]);
+        for (const auto& child : node.children) RenderNode(child, hooks);
+        ImGui::PopFont();
+        return;
+    case Atom::I:
+    case Atom::Em:
+        ImGui::PushFont(ImGui::GetIO().Fonts->Fonts[3]);
+        for (const auto& child : node.children) RenderNode(child, hooks);
+        ImGui::PopFont();
+        return;
+    default:
+        break;
+    }
+    for (const auto& child : node.children) {
+        RenderNode(child, hooks);
+    }
+}
+
+void RenderPage(const HTMLNode& root, const PageRenderHooks& hooks) {
+    RenderNode(root, hooks);
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <string_view>
+#include "imgui.h"
+#include "html_parser.h"
+
+class FindInPage;
+
+struct PageImage {
+    ImTextureID id = 0;
+    int width = 0;
+    int height = 0;
+};
+
+// What drawing a page needs from whoever owns it. Empty hooks are skipped,
+// so a bare PageRenderHooks draws text and placeholders only.
+struct PageRenderHooks {
+    std::function<bool(const HTMLNode& img, PageImage& out)> findImage;
+    std::function<void(std::string_view href)> onLinkClicked;
+    std::function<void(std::string_view href)> onLinkHovered;
+    FindInPage* find = nullptr;  // matches to highlight; null draws none
+};
+
+// Emits the widgets for a parsed page into the current ImGui window. Fonts 1-3
+// of the atlas are used for headings, bold and italic text.
+void RenderPage(const HTMLNode& root, const PageRenderHooks& hooks);
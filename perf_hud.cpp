@@ -0,0 +1,82 @@
+#include "perf_hud.h"
+#include <algorithm>
+#include <cstdio>
+
+void PerfHUD::RecordFrame(float deltaSeconds) {
+    m_frameMs[m_frameIndex] = deltaSeconds * 1000.0f;
+    m_frameIndex = (m_frameIndex + 1) % kHistory;
+}
+
+void PerfHUD::RecordRender(double ms) {
+    m_renderMs[m_renderIndex] = static_cast<float>(ms);
+    m_renderIndex = (m_renderIndex + 1) % kHistory;
+}
+
+void PerfHUD::RecordDrawData(const ImDrawData* drawData) {
+    if (!drawData) return;
+    m_vertices = drawData->TotalVtxCount;
+    m_indices = drawData->TotalIdxCount;
+    m_drawLists = drawData->CmdListsCount;
+    m_drawCalls = 0;
+    for (int i = 0; i < drawData->CmdListsCount; i++) {
+        m_drawCalls += drawData->CmdLists[i]->CmdBuffer.Size;
+    }
+}
+
+static void Summarize(const float* values, int count, float& avg, float& worst) {
+    float sum = 0;
+    worst = 0;
+    for (int i = 0; i < count; i++) {
+        sum += values[i];
+        worst = std::max(worst, values[i]);
+    }
+    avg = sum / count;
+}
+
+void PerfHUD::Draw(const PageMetrics& page) {
+    if (!visible) return;
+
+    const ImGuiViewport* viewport = ImGui::GetMainViewport();
+    ImGui::SetNextWindowPos(ImVec2(viewport->WorkPos.x + viewport->WorkSize.x - 10, viewport->WorkPos.y + 40),
+                            ImGuiCond_Always, ImVec2(1, 0));
+    ImGui::SetNextWindowBgAlpha(0.85f);
+    ImGuiWindowFlags flags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize |
+                             ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoFocusOnAppearing |
+                             ImGuiWindowFlags_NoNav;
+    if (ImGui::Begin("Performance", &visible, flags)) {
+        float avg, worst;
+        char overlay[64];
+
+        Summarize(m_frameMs, kHistory, avg, worst);
+        snprintf(overlay, sizeof(overlay), "avg %.1f ms  max %.1f ms", avg, worst);
+        ImGui::Text("Frame time (%.0f fps)", avg > 0 ? 1000.0f / avg : 0.0f);
+        ImGui::PlotLines("##frame", m_frameMs, kHistory, m_frameIndex, overlay, 0.0f, 50.0f, ImVec2(260, 50));
+
+        Summarize(m_renderMs, kHistory, avg, worst);
+        snprintf(overlay, sizeof(overlay), "avg %.2f ms  max %.2f ms", avg, worst);
+        ImGui::Text("RenderHTMLContent CPU");
+        ImGui::PlotLines("##render", m_renderMs, kHistory, m_renderIndex, overlay, 0.0f, 16.0f, ImVec2(260, 40));
+
+        ImGui::Separator();
+        ImGui::Text("Draw: %d lists, %d calls", m_drawLists, m_drawCalls);
+        ImGui::Text("      %d vertices, %d indices", m_vertices, m_indices);
+
+        ImGui::Separator();
+        ImGui::Text("DOM nodes: %d, depth %d (parsed in %.2f ms)", page.domNodes, page.domDepth, page.parseMs);
+        if (page.findMatches >= 0) {
+            ImGui::Text("Find: %d matches in %.3f ms", page.findMatches, page.findMs);
+        }
+        if (page.suggestions >= 0) {
+            ImGui::Text("URL suggestions: %d in %.3f ms", page.suggestions, page.suggestMs);
+        }
+        ImGui::Text("Textures: %d, %.1f MiB", page.textures, page.textureBytes / (1024.0 * 1024.0));
+
+        ImGui::Separator();
+        ImGui::Text("Network: %s", page.loading ? "loading page" : "idle");
+        ImGui::Text("  %d pending, %d waiting to decode", page.pendingRequests, page.decodeBacklog);
+        ImGui::Text("  images: %d requested, %d transfers", page.imageRequests, page.transfers);
+        ImGui::Text("          %d coalesced, %d cancelled", page.coalesced, page.cancelled);
+        ImGui::TextDisabled("F12 to hide");
+    }
+    ImGui::End();
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "imgui.h"
+#include <cstddef>
+
+// Toggleable overlay with frame timing, ImGui draw statistics and page/network
+// counters, for diagnosing janky pages without attaching a profiler.
+class PerfHUD {
+public:
+    static const int kHistory = 120;  // frames kept for the graphs
+
+    // Whatever the browser knows about the current page this frame.
+    struct PageMetrics {
+        int domNodes = 0;
+        int domDepth = 0;
+        double parseMs = 0;
+        int findMatches = -1;      // -1 while the find bar is closed
+        double findMs = 0;         // last find-in-page keystroke
+        int suggestions = -1;      // -1 while the URL bar shows none
+        double suggestMs = 0;      // last URL bar keystroke
+        int textures = 0;
+        size_t textureBytes = 0;
+        int pendingRequests = 0;   // in the loader's request table
+        int decodeBacklog = 0;     // bodies waiting for a decode thread
+        int imageRequests = 0;
+        int transfers = 0;
+        int coalesced = 0;
+        int cancelled = 0;
+        bool loading = false;
+    };
+
+    bool visible = false;
+
+    void RecordFrame(float deltaSeconds);
+    void RecordRender(double ms);
+    // Call after ImGui::Render() with the frame's draw data.
+    void RecordDrawData(const ImDrawData* drawData);
+
+    void Draw(const PageMetrics& page);
+
+private:
+    float m_frameMs[kHistory] = {};
+    float m_renderMs[kHistory] = {};
+    int m_frameIndex = 0;  // next slot to write
+    int m_renderIndex = 0;
+    int m_vertices = 0;
+    int m_indices = 0;
+    int m_drawLists = 0;
+    int m_drawCalls = 0;
+};
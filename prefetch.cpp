@@ -0,0 +1,118 @@
+#include "prefetch.h"
+#include "encoding.h"
+#include <iostream>
+
+std::string LinkPrefetcher::HostOf(const std::string& url) {
+    size_t scheme = url.find("://");
+    if (scheme == std::string::npos) return "";
+    size_t start = scheme + 3;
+    size_t end = url.find_first_of("/?#", start);
+    return url.substr(0, end == std::string::npos ? std::string::npos : end);
+}
+
+void LinkPrefetcher::OnHover(const std::string& url, double now) {
+    m_hoveredThisFrame = true;
+    if (url != m_hoverUrl) {
+        m_hoverUrl = url;
+        m_hoverStart = now;
+        m_preconnected = false;
+        m_prefetched = false;
+    }
+    // only plain web links are worth speculating on
+    if (url.compare(0, 7, "http://") != 0 && url.compare(0, 8, "https://") != 0) return;
+
+    double hovered = now - m_hoverStart;
+    if (!m_preconnected && hovered >= kPreconnectDelay) {
+        m_preconnected = true;
+        // hosts past their cooldown are forgotten, so the map stays small
+        for (auto it = m_hostLastPreconnect.begin(); it != m_hostLastPreconnect.end();) {
+            it = now - it->second >= kHostCooldown ? m_hostLastPreconnect.erase(it) : std::next(it);
+        }
+        std::string host = HostOf(url);
+        bool cooling = m_hostLastPreconnect.count(host) != 0;
+        if (!host.empty() && !cooling && m_inFlight < kMaxInFlight) {
+            m_hostLastPreconnect[host] = now;
+            m_inFlight++;
+            m_stats.preconnects++;
+            m_loader.Preconnect(url, m_preconnectToken, [this](Response&) { m_inFlight--; });
+        }
+    }
+    if (prefetchDocuments && !m_prefetched && hovered >= kPrefetchDelay) {
+        m_prefetched = true;
+        StartPrefetch(url, now);
+    }
+}
+
+void LinkPrefetcher::StartPrefetch(const std::string& url, double now) {
+    auto cached = m_cache.find(url);
+    if (cached != m_cache.end() && now - cached->second.fetchedAt < kCacheTTL) return;
+    if (m_pending.count(url)) return;
+    if (m_inFlight >= kMaxInFlight || m_pagePrefetches >= kMaxPrefetchesPerPage) return;
+
+    CancelToken token = MakeCancelToken();
+    m_pending[url] = token;
+    m_inFlight++;
+    m_pagePrefetches++;
+    m_stats.prefetches++;
+    // the loader drops the transfer once it is known to be over the limit;
+    // a navigation joining it lifts the limit, so the size is checked again
+    m_loader.LoadDocument(url, token, [this, url](Response& response) {
+        m_inFlight--;
+        m_pending.erase(url);
+        if (!response.ok || response.status < 200 || response.status >= 300) return;
+        if (response.body.Size() > kMaxBodySize) return;
+
+        if (m_cache.size() >= kMaxCacheEntries) {
+            // evict the oldest entry
+            auto oldest = m_cache.begin();
+            for (auto it = m_cache.begin(); it != m_cache.end(); ++it) {
+                if (it->second.fetchedAt < oldest->second.fetchedAt) oldest = it;
+            }
+            m_cache.erase(oldest);
+        }
+        Entry& entry = m_cache[url];
+        entry.body = response.body.TakeString();
+        DecodeToUTF8(entry.body, response.contentType);
+        entry.fetchedAt = m_lastFrameTime;
+    }, kMaxBodySize);
+}
+
+void LinkPrefetcher::EndFrame(double now) {
+    m_lastFrameTime = now;
+    if (!m_hoveredThisFrame) m_hoverUrl.clear();
+    m_hoveredThisFrame = false;
+}
+
+bool LinkPrefetcher::Take(const std::string& url, double now, std::string& body) {
+    auto it = m_cache.find(url);
+    if (it == m_cache.end()) return false;
+    bool fresh = now - it->second.fetchedAt < kCacheTTL;
+    if (fresh) {
+        body = std::move(it->second.body);
+        m_stats.hits++;
+        std::cout << "[Prefetch] Served from cache: " << url << std::endl;
+    }
+    m_cache.erase(it);
+    return fresh;
+}
+
+void LinkPrefetcher::Adopt(const std::string& url) {
+    auto it = m_pending.find(url);
+    if (it == m_pending.end()) return;
+    m_loader.Cancel(it->second);
+    m_pending.erase(it);
+    m_inFlight--;
+    m_stats.hits++;
+}
+
+void LinkPrefetcher::Reset() {
+    for (auto& [url, token] : m_pending) {
+        m_loader.Cancel(token);
+    }
+    m_pending.clear();
+    m_loader.Cancel(m_preconnectToken);
+    m_preconnectToken = MakeCancelToken();
+    m_inFlight = 0;
+    m_pagePrefetches = 0;
+    m_hoverUrl.clear();
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <string>
+#include <map>
+#include <deque>
+#include "loader.h"
+
+// Speculative loading for links under the mouse. After a short hover the
+// link's origin is preconnected; a little later the document itself is
+// fetched into a small short-lived cache so a click can be served from memory.
+// Everything is rate limited so sweeping the mouse over a page stays cheap.
+class LinkPrefetcher {
+public:
+    static constexpr double kPreconnectDelay = 0.10;  // seconds of hover
+    static constexpr double kPrefetchDelay = 0.30;
+    static constexpr double kCacheTTL = 30.0;
+    static constexpr double kHostCooldown = 10.0;     // between preconnects to one host
+    static constexpr int kMaxInFlight = 2;
+    static constexpr int kMaxPrefetchesPerPage = 8;
+    static constexpr size_t kMaxCacheEntries = 8;
+    static constexpr size_t kMaxBodySize = 4 * 1024 * 1024;
+
+    struct Stats {
+        int preconnects = 0;
+        int prefetches = 0;
+        int hits = 0;
+    };
+
+    explicit LinkPrefetcher(ResourceLoader& loader) : m_loader(loader) {}
+
+    bool prefetchDocuments = true;  // off: preconnect only
+
+    // Call every frame a link is hovered, with its resolved URL.
+    void OnHover(const std::string& url, double now);
+    // Call once per frame after the page has been drawn.
+    void EndFrame(double now);
+
+    // Serves a navigation from the cache if a fresh copy is there.
+    bool Take(const std::string& url, double now, std::string& body);
+    // The navigation to url has attached to the loader; drop our own interest
+    // so the in-flight prefetch, if any, is delivered to the page instead.
+    void Adopt(const std::string& url);
+    // New page: abandon outstanding speculation for the old one.
+    void Reset();
+
+    const Stats& GetStats() const { return m_stats; }
+
+private:
+    struct Entry {
+        std::string body;
+        double fetchedAt = 0;
+    };
+
+    static std::string HostOf(const std::string& url);
+    void StartPrefetch(const std::string& url, double now);
+
+    ResourceLoader& m_loader;
+    Stats m_stats;
+
+    std::string m_hoverUrl;
+    double m_hoverStart = 0;
+    bool m_hoveredThisFrame = false;
+    bool m_preconnected = false;
+    bool m_prefetched = false;
+    double m_lastFrameTime = 0;
+
+    int m_inFlight = 0;
+    int m_pagePrefetches = 0;
+    std::map<std::string, CancelToken> m_pending;  // url -> prefetch in flight
+    std::map<std::string, double> m_hostLastPreconnect;
+    std::map<std::string, Entry> m_cache;
+    CancelToken m_preconnectToken = MakeCancelToken();
+};
@@ -0,0 +1,121 @@
+#include "recv_buffer.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+struct RecvBuffer::Chunk {
+    char data[kChunkSize];
+};
+
+// Free chunks are kept around for the next transfer; a few MB is plenty to
+// cover the bodies in flight for a typical page.
+static std::mutex g_poolMutex;
+static std::vector<void*> g_pool;
+static const size_t kMaxPooledChunks = 128;
+
+RecvBuffer::Chunk* RecvBuffer::AcquireChunk() {
+    {
+        std::lock_guard<std::mutex> lock(g_poolMutex);
+        if (!g_pool.empty()) {
+            Chunk* chunk = static_cast<Chunk*>(g_pool.back());
+            g_pool.pop_back();
+            return chunk;
+        }
+    }
+    return new Chunk;
+}
+
+void RecvBuffer::ReleaseChunk(Chunk* chunk) {
+    {
+        std::lock_guard<std::mutex> lock(g_poolMutex);
+        if (g_pool.size() < kMaxPooledChunks) {
+            g_pool.push_back(chunk);
+            return;
+        }
+    }
+    delete chunk;
+}
+
+RecvBuffer::RecvBuffer(RecvBuffer&& other) noexcept {
+    *this = std::move(other);
+}
+
+RecvBuffer& RecvBuffer::operator=(RecvBuffer&& other) noexcept {
+    if (this != &other) {
+        Clear();
+        m_flat = std::move(other.m_flat);
+        m_reserved = other.m_reserved;
+        m_chunks = std::move(other.m_chunks);
+        m_size = other.m_size;
+        other.m_chunks.clear();
+        other.m_reserved = false;
+        other.m_size = 0;
+    }
+    return *this;
+}
+
+void RecvBuffer::Reserve(size_t contentLength) {
+    if (m_size != 0 || contentLength == 0) return;
+    m_flat.reserve(std::min(contentLength, kMaxReserve));
+    m_reserved = true;
+}
+
+void RecvBuffer::Append(const char* data, size_t size) {
+    m_size += size;
+    if (m_reserved) {
+        m_flat.append(data, size);
+        return;
+    }
+    while (size > 0) {
+        size_t used = (m_size - size) % kChunkSize;
+        if (used == 0) m_chunks.push_back(AcquireChunk());
+        size_t n = std::min(size, kChunkSize - used);
+        memcpy(m_chunks.back()->data + used, data, n);
+        data += n;
+        size -= n;
+    }
+}
+
+void RecvBuffer::Clear() {
+    for (Chunk* chunk : m_chunks) ReleaseChunk(chunk);
+    m_chunks.clear();
+    std::string().swap(m_flat);
+    m_reserved = false;
+    m_size = 0;
+}
+
+std::string_view RecvBuffer::View() const {
+    if (m_reserved) return m_flat;
+    if (m_chunks.empty()) return {};
+    return std::string_view(m_chunks[0]->data, m_size);
+}
+
+size_t RecvBuffer::Read(size_t offset, char* out, size_t size) const {
+    if (offset >= m_size) return 0;
+    size = std::min(size, m_size - offset);
+    if (m_reserved) {
+        memcpy(out, m_flat.data() + offset, size);
+        return size;
+    }
+    size_t copied = 0;
+    while (copied < size) {
+        size_t index = (offset + copied) / kChunkSize;
+        size_t within = (offset + copied) % kChunkSize;
+        size_t n = std::min(size - copied, kChunkSize - within);
+        memcpy(out + copied, m_chunks[index]->data + within, n);
+        copied += n;
+    }
+    return copied;
+}
+
+std::string RecvBuffer::TakeString() {
+    std::string out;
+    if (m_reserved) {
+        out = std::move(m_flat);
+    } else {
+        out.resize(m_size);
+        Read(0, out.data(), m_size);
+    }
+    Clear();
+    return out;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+
+// Accumulates a response body without the grow-and-copy cycle of appending
+// to a std::string. When the server announced a Content-Length the body is
+// received into one exact reservation; otherwise it goes into a chain of
+// fixed-size chunks borrowed from a process-wide recycled pool.
+class RecvBuffer {
+public:
+    static constexpr size_t kChunkSize = 32 * 1024;
+    // never trust a header for more than this up front
+    static constexpr size_t kMaxReserve = 64 * 1024 * 1024;
+
+    RecvBuffer() = default;
+    ~RecvBuffer() { Clear(); }
+    RecvBuffer(RecvBuffer&& other) noexcept;
+    RecvBuffer& operator=(RecvBuffer&& other) noexcept;
+    RecvBuffer(const RecvBuffer&) = delete;
+    RecvBuffer& operator=(const RecvBuffer&) = delete;
+
+    // Switches to a single contiguous block. Only honoured before any data.
+    void Reserve(size_t contentLength);
+    void Append(const char* data, size_t size);
+    void Clear();
+
+    size_t Size() const { return m_size; }
+    bool Empty() const { return m_size == 0; }
+    bool Contiguous() const { return m_chunks.size() <= 1; }
+
+    // Valid only when Contiguous().
+    std::string_view View() const;
+
+    // Copies up to `size` bytes starting at `offset`, across chunk boundaries.
+    size_t Read(size_t offset, char* out, size_t size) const;
+
+    // Hands the body over as a string. Free when contiguous; a chunk chain is
+    // linearized with a single exact-size copy.
+    std::string TakeString();
+
+private:
+    struct Chunk;
+    static Chunk* AcquireChunk();
+    static void ReleaseChunk(Chunk* chunk);
+
+    std::string m_flat;            // contiguous mode
+    bool m_reserved = false;
+    std::vector<Chunk*> m_chunks;  // chained mode
+    size_t m_size = 0;
+};
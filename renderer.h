@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include "imgui.h"
+
+// Where decoded page images end up. The window uploads them to OpenGL; a
+// headless run keeps nothing but their size, so the engine never needs a GL
+// context.
+class Renderer {
+public:
+    virtual ~Renderer() = default;
+
+    // rgba is width*height*4 bytes. Returns 0 on failure.
+    virtual ImTextureID CreateTexture(const unsigned char* rgba, int width, int height) = 0;
+    virtual void DestroyTexture(ImTextureID id) = 0;
+    // Memory a texture of this size occupies once created, for the HUD.
+    virtual size_t TextureBytes(int width, int height) const = 0;
+};
+
+// Hands out placeholder ids; layout still sees every image at its real size.
+class NullRenderer : public Renderer {
+public:
+    ImTextureID CreateTexture(const unsigned char*, int, int) override { return ++m_lastId; }
+    void DestroyTexture(ImTextureID) override {}
+    size_t TextureBytes(int, int) const override { return 0; }
+
+private:
+    ImTextureID m_lastId = 0;
+};
@@ -0,0 +1,114 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define SB_SIMD_SSE2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SB_SIMD_NEON 1
+#endif
+
+// First p in [begin, end - 1) with p[0] == a and p[1] == b, or end. Compares
+// 16 positions at a time against both bytes and only looks closer where the
+// two masks agree, so long runs without the pair cost two loads and a test
+// per block.
+inline const char* FindPair(const char* begin, const char* end, char a, char b) {
+    const char* p = begin;
+    if (end - begin < 2) return end;
+    const char* last = end - 1;  // a pair needs p + 1 < end
+#if defined(SB_SIMD_SSE2)
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    for (; last - p >= 16; p += 16) {
+        __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+        int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, va), _mm_cmpeq_epi8(second, vb)));
+        if (mask) return p + __builtin_ctz(static_cast<unsigned>(mask));
+    }
+#elif defined(SB_SIMD_NEON)
+    const uint8x16_t va = vdupq_n_u8(static_cast<uint8_t>(a));
+    const uint8x16_t vb = vdupq_n_u8(static_cast<uint8_t>(b));
+    for (; last - p >= 16; p += 16) {
+        uint8x16_t first = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+        uint8x16_t second = vld1q_u8(reinterpret_cast<const uint8_t*>(p + 1));
+        uint8x16_t both = vandq_u8(vceqq_u8(first, va), vceqq_u8(second, vb));
+        // narrow to 4 bits per byte, the usual NEON stand-in for movemask
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(both), 4)), 0);
+        if (mask) return p + (__builtin_ctzll(mask) >> 2);
+    }
+#endif
+    for (; p < last; p++) {
+        if (p[0] == a && p[1] == b) return p;
+    }
+    return end;
+}
+
+// First byte in [begin, end) with the high bit set, or end. Text is mostly
+// ASCII, so this is how converters find the next byte worth looking at.
+inline const char* FindNonASCII(const char* begin, const char* end) {
+    const char* p = begin;
+#if defined(SB_SIMD_SSE2)
+    for (; end - p >= 16; p += 16) {
+        int mask = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+        if (mask) return p + __builtin_ctz(static_cast<unsigned>(mask));
+    }
+#elif defined(SB_SIMD_NEON)
+    for (; end - p >= 16; p += 16) {
+        uint8x16_t high = vcltq_s8(vld1q_s8(reinterpret_cast<const int8_t*>(p)), vdupq_n_s8(0));
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(high), 4)), 0);
+        if (mask) return p + (__builtin_ctzll(mask) >> 2);
+    }
+#endif
+    for (; p < end; p++) {
+        if (static_cast<unsigned char>(*p) >= 0x80) return p;
+    }
+    return end;
+}
+
+// First occurrence of needle (size n) in [begin, end), or end. Compares the
+// needle's first and last bytes against 16 positions at a time and checks
+// the middle only where both match, so ordinary text is rejected a block at
+// a time even when the first byte is common.
+inline const char* FindSubstring(const char* begin, const char* end, const char* needle, size_t n) {
+    if (n == 0) return begin;
+    if (static_cast<size_t>(end - begin) < n) return end;
+    if (n == 1) {
+        const void* hit = memchr(begin, needle[0], end - begin);
+        return hit ? static_cast<const char*>(hit) : end;
+    }
+    const char* p = begin;
+    const char* last = end - n + 1;  // candidates are [begin, last)
+#if defined(SB_SIMD_SSE2)
+    const __m128i head = _mm_set1_epi8(needle[0]);
+    const __m128i tail = _mm_set1_epi8(needle[n - 1]);
+    for (; last - p >= 16; p += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + n - 1));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, head), _mm_cmpeq_epi8(b, tail))));
+        for (; mask; mask &= mask - 1) {
+            const char* candidate = p + __builtin_ctz(mask);
+            if (memcmp(candidate + 1, needle + 1, n - 2) == 0) return candidate;
+        }
+    }
+#elif defined(SB_SIMD_NEON)
+    const uint8x16_t head = vdupq_n_u8(static_cast<uint8_t>(needle[0]));
+    const uint8x16_t tail = vdupq_n_u8(static_cast<uint8_t>(needle[n - 1]));
+    for (; last - p >= 16; p += 16) {
+        uint8x16_t a = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+        uint8x16_t b = vld1q_u8(reinterpret_cast<const uint8_t*>(p + n - 1));
+        uint8x16_t both = vandq_u8(vceqq_u8(a, head), vceqq_u8(b, tail));
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(both), 4)), 0);
+        for (; mask; mask &= ~(0xFull << (__builtin_ctzll(mask) & ~3))) {
+            const char* candidate = p + (__builtin_ctzll(mask) >> 2);
+            if (memcmp(candidate + 1, needle + 1, n - 2) == 0) return candidate;
+        }
+    }
+#endif
+    for (; p < last; p++) {
+        if (p[0] == needle[0] && p[n - 1] == needle[n - 1] && memcmp(p + 1, needle + 1, n - 2) == 0) return p;
+    }
+    return end;
+}
@@ -0,0 +1,202 @@
+#include "suggest_index.h"
+#include <fcntl.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include "encoding.h"
+#include "history.h"
+#include "text_index.h"
+#include "trace.h"
+
+static const char kMagic[4] = {'S', 'B', 'S', 'X'};
+static constexpr uint32_t kVersion = 1;
+static constexpr size_t kMaxURLKey = 256;
+
+// File: Header, Key[keyCount] sorted by key bytes, the uint32 postings, then
+// the key bytes.
+struct SuggestIndex::Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t keyCount;
+    uint64_t stamp;
+    uint64_t keysOffset;
+    uint64_t postingsOffset;
+    uint64_t stringsOffset;
+    uint64_t size;
+};
+
+struct SuggestIndex::Key {
+    uint32_t stringOffset;
+    uint32_t stringSize;
+    uint32_t firstPosting;
+    uint32_t postingCount;
+};
+
+std::string SuggestIndex::URLKey(std::string_view url) {
+    size_t scheme = url.find("://");
+    if (scheme != std::string_view::npos && scheme < 16) url.remove_prefix(scheme + 3);
+    if (url.size() >= 4 && strncasecmp(url.data(), "www.", 4) == 0) url.remove_prefix(4);
+    std::string key(url.substr(0, kMaxURLKey));
+    FoldCase(key.data(), key.size(), &key[0]);
+    return key;
+}
+
+// Calls fn(key, wholeURL) for each completion key of entry.
+template <typename Fn>
+static void ForEachKey(const HistoryEntry& entry, Fn&& fn) {
+    std::string url = SuggestIndex::URLKey(entry.url);
+    fn(std::string_view(url), true);
+    ForEachTerm(url, [&](std::string_view word) { fn(word, false); });
+    ForEachTerm(entry.title, [&](std::string_view word) { fn(word, false); });
+}
+
+int SuggestIndex::Match(const HistoryEntry& entry, std::string_view prefix) {
+    int match = 0;
+    ForEachKey(entry, [&](std::string_view key, bool wholeURL) {
+        if (key.substr(0, prefix.size()) == prefix) match = std::max(match, wholeURL ? 2 : 1);
+    });
+    return match;
+}
+
+SuggestIndex::SuggestIndex(std::string path, uint64_t stamp) : m_path(std::move(path)) {
+    if (m_path.empty()) return;
+    int fd = open(m_path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            m_mapped = mapped;
+            m_mappedSize = st.st_size;
+        }
+    }
+    close(fd);
+    if (m_mapped && (!Attach(static_cast<const char*>(m_mapped), m_mappedSize) || m_header->stamp != stamp)) Unmap();
+}
+
+SuggestIndex::~SuggestIndex() {
+    Unmap();
+}
+
+void SuggestIndex::Unmap() {
+    if (m_mapped) munmap(m_mapped, m_mappedSize);
+    m_mapped = nullptr;
+    m_mappedSize = 0;
+    m_header = nullptr;
+}
+
+bool SuggestIndex::Attach(const char* data, size_t size) {
+    m_header = nullptr;
+    if (size < sizeof(Header)) return false;
+    const Header* h = reinterpret_cast<const Header*>(data);
+    if (memcmp(h->magic, kMagic, sizeof(kMagic)) != 0 || h->version != kVersion || h->size != size ||
+        h->keysOffset != sizeof(Header) || h->postingsOffset != h->keysOffset + uint64_t(h->keyCount) * sizeof(Key) ||
+        h->stringsOffset < h->postingsOffset || (h->stringsOffset - h->postingsOffset) % sizeof(uint32_t) != 0 ||
+        h->stringsOffset > size) {
+        return false;
+    }
+    const Key* keys = reinterpret_cast<const Key*>(data + h->keysOffset);
+    const uint32_t* postings = reinterpret_cast<const uint32_t*>(data + h->postingsOffset);
+    uint64_t postingCount = (h->stringsOffset - h->postingsOffset) / sizeof(uint32_t);
+    uint64_t stringsSize = size - h->stringsOffset;
+    for (uint32_t i = 0; i < h->keyCount; i++) {
+        if (uint64_t(keys[i].stringOffset) + keys[i].stringSize > stringsSize ||
+            uint64_t(keys[i].firstPosting) + keys[i].postingCount > postingCount) {
+            return false;
+        }
+    }
+    for (uint64_t i = 0; i < postingCount; i++) {
+        if ((postings[i] >> 1) >= h->entryCount) return false;
+    }
+    m_header = h;
+    m_keys = keys;
+    m_postings = postings;
+    m_strings = data + h->stringsOffset;
+    return true;
+}
+
+uint32_t SuggestIndex::EntryCount() const {
+    return m_header ? m_header->entryCount : 0;
+}
+
+void SuggestIndex::Build(const std::vector<HistoryEntry>& entries, uint64_t stamp) {
+    TRACE_SCOPE("history", "SuggestIndex::Build");
+    // every (key, posting) pair, keys copied into one buffer, then sorted
+    struct Pair {
+        uint32_t offset, size, posting;
+    };
+    std::string arena;
+    std::vector<Pair> pairs;
+    for (uint32_t i = 0; i < entries.size(); i++) {
+        ForEachKey(entries[i], [&](std::string_view key, bool wholeURL) {
+            pairs.push_back({static_cast<uint32_t>(arena.size()), static_cast<uint32_t>(key.size()), i << 1 | wholeURL});
+            arena.append(key.data(), key.size());
+        });
+    }
+    auto text = [&](const Pair& p) { return std::string_view(arena.data() + p.offset, p.size); };
+    std::sort(pairs.begin(), pairs.end(), [&](const Pair& a, const Pair& b) {
+        int order = text(a).compare(text(b));
+        return order != 0 ? order < 0 : a.posting < b.posting;
+    });
+
+    std::vector<Key> keys;
+    std::vector<uint32_t> postings;
+    std::string strings;
+    for (size_t i = 0; i < pairs.size(); i++) {
+        bool newKey = i == 0 || text(pairs[i]) != text(pairs[i - 1]);
+        if (newKey) {
+            keys.push_back({static_cast<uint32_t>(strings.size()), pairs[i].size, static_cast<uint32_t>(postings.size()), 0});
+            strings.append(text(pairs[i]));
+        } else if (pairs[i].posting == pairs[i - 1].posting) {
+            continue;  // a title repeating a word
+        }
+        postings.push_back(pairs[i].posting);
+        keys.back().postingCount++;
+    }
+
+    Header h = {};
+    memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.version = kVersion;
+    h.entryCount = static_cast<uint32_t>(entries.size());
+    h.keyCount = static_cast<uint32_t>(keys.size());
+    h.stamp = stamp;
+    h.keysOffset = sizeof(Header);
+    h.postingsOffset = h.keysOffset + keys.size() * sizeof(Key);
+    h.stringsOffset = h.postingsOffset + postings.size() * sizeof(uint32_t);
+    h.size = h.stringsOffset + strings.size();
+    Unmap();
+    m_memory.clear();
+    m_memory.reserve(h.size);
+    m_memory.append(reinterpret_cast<const char*>(&h), sizeof(h));
+    m_memory.append(reinterpret_cast<const char*>(keys.data()), keys.size() * sizeof(Key));
+    m_memory.append(reinterpret_cast<const char*>(postings.data()), postings.size() * sizeof(uint32_t));
+    m_memory += strings;
+    Attach(m_memory.data(), m_memory.size());
+
+    if (m_path.empty()) return;
+    std::string tmp = m_path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    bool ok = f && fwrite(m_memory.data(), 1, m_memory.size(), f) == m_memory.size();
+    if (f) ok = fclose(f) == 0 && ok;
+    if (ok) ok = rename(tmp.c_str(), m_path.c_str()) == 0;
+    if (!ok) {
+        unlink(tmp.c_str());
+        std::cerr << "[History] Cannot write " << m_path << std::endl;
+    }
+}
+
+void SuggestIndex::Find(std::string_view prefix, std::vector<uint32_t>& out) const {
+    if (!m_header) return;
+    auto key = [&](const Key& k) { return std::string_view(m_strings + k.stringOffset, k.stringSize); };
+    const Key* end = m_keys + m_header->keyCount;
+    const Key* k = std::lower_bound(m_keys, end, prefix, [&](const Key& k, std::string_view p) { return key(k) < p; });
+    for (; k != end && key(*k).substr(0, prefix.size()) == prefix; ++k) {
+        out.insert(out.end(), m_postings + k->firstPosting, m_postings + k->firstPosting + k->postingCount);
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct HistoryEntry;
+
+// URL bar completion keys of history entries: the URL without its scheme and
+// "www.", the words of the URL and the words of the title, all case-folded.
+// They are kept as one sorted table of distinct keys, each with the entries
+// it came from, so every key starting with what was typed is one binary
+// search away. The table is written to a file and memory-mapped next time,
+// so startup does not rebuild it.
+class SuggestIndex {
+public:
+    // Maps path if it was written for the same history: stamp identifies
+    // the history's state, and must match the one given to Build.
+    SuggestIndex(std::string path, uint64_t stamp);
+    ~SuggestIndex();
+    SuggestIndex(const SuggestIndex&) = delete;
+    SuggestIndex& operator=(const SuggestIndex&) = delete;
+
+    // Entries [0, EntryCount()) are in the table; 0 if nothing was mapped.
+    uint32_t EntryCount() const;
+
+    // Replaces the table with one over entries and writes it to path.
+    void Build(const std::vector<HistoryEntry>& entries, uint64_t stamp);
+
+    // Appends (entry << 1 | whole URL) for each key starting with prefix; the
+    // low bit is set when prefix matched the start of the URL itself rather
+    // than a word in it. An entry can appear more than once.
+    void Find(std::string_view prefix, std::vector<uint32_t>& out) const;
+
+    // The same test for one entry, for entries changed since the table was
+    // built: 0 for no match, 1 for a word, 2 for the start of the URL.
+    static int Match(const HistoryEntry& entry, std::string_view prefix);
+
+    // What a typed URL is compared against: folded, without scheme or "www.".
+    static std::string URLKey(std::string_view url);
+
+private:
+    struct Header;
+    struct Key;
+    bool Attach(const char* data, size_t size);
+    void Unmap();
+
+    std::string m_path;
+    std::string m_memory;  // the table when built this run
+    void* m_mapped = nullptr;
+    size_t m_mappedSize = 0;
+    const Header* m_header = nullptr;
+    const Key* m_keys = nullptr;
+    const char* m_strings = nullptr;
+    const uint32_t* m_postings = nullptr;
+};
@@ -0,0 +1,576 @@
+#include "text_index.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+#include "trace.h"
+
+namespace {
+
+const char kMagic[4] = {'S', 'B', 'I', 'X'};
+constexpr uint32_t kVersion = 1;
+constexpr size_t kMergeWidth = 4;        // segments of one size class merged at once
+constexpr int kMaxMergeTier = 7;         // segments past 16k documents are left as they are,
+                                         // which bounds the pause a merge costs
+constexpr size_t kMaxPrefixTerms = 64;   // expansions of a prefix term, per segment
+constexpr size_t kMaxQueryTerms = 16;
+constexpr float kK1 = 1.2f;
+constexpr float kB = 0.75f;
+
+// Segment file: Header, DocEntry[docCount], TermEntry[termCount] sorted by
+// term bytes, the term bytes, then the posting lists.
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t firstDoc;  // the range of ids this segment covers
+    uint32_t lastDoc;
+    uint32_t docCount;
+    uint32_t termCount;
+    uint64_t totalLength;  // terms in all documents, for BM25's average
+    uint64_t termsOffset;
+    uint64_t stringsOffset;
+    uint64_t postingsOffset;
+    uint64_t size;
+};
+
+struct DocEntry {
+    uint32_t doc;
+    uint32_t length;  // in terms
+};
+
+struct TermEntry {
+    uint32_t stringOffset;
+    uint32_t stringSize;
+    uint32_t docFreq;
+    uint32_t postingsSize;
+    uint64_t postingsOffset;
+};
+
+static_assert(sizeof(Header) == 64 && sizeof(DocEntry) == 8 && sizeof(TermEntry) == 24, "file layout");
+
+void PutVarint(std::string& out, uint32_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+uint32_t GetVarint(const unsigned char*& p, const unsigned char* end) {
+    uint32_t v = 0;
+    for (int shift = 0; p < end && shift < 35; shift += 7) {
+        unsigned char b = *p++;
+        v |= static_cast<uint32_t>(b & 0x7F) << shift;
+        if (!(b & 0x80)) break;
+    }
+    return v;
+}
+
+// Size class of a segment: segments of one class hold within 4x as many
+// documents as each other.
+int Tier(uint32_t docCount) {
+    int tier = 0;
+    for (; docCount >= kMergeWidth; docCount /= kMergeWidth) tier++;
+    return tier;
+}
+
+// Lays out one segment in memory. Documents come first; terms must then be
+// given in sorted order, each with its postings by ascending document index.
+class SegmentBuilder {
+public:
+    void AddDoc(uint32_t doc, uint32_t length) {
+        m_docs.push_back({doc, length});
+        m_totalLength += length;
+    }
+    uint32_t DocCount() const { return static_cast<uint32_t>(m_docs.size()); }
+
+    void BeginTerm(std::string_view term) {
+        m_term = {static_cast<uint32_t>(m_strings.size()), static_cast<uint32_t>(term.size()), 0, 0, m_postings.size()};
+        m_strings.append(term.data(), term.size());
+        m_nextIndex = 0;
+    }
+    void AddPosting(uint32_t index, uint32_t tf) {
+        PutVarint(m_postings, index - m_nextIndex);
+        PutVarint(m_postings, tf);
+        m_nextIndex = index + 1;
+        m_term.docFreq++;
+    }
+    void EndTerm() {
+        if (m_term.docFreq == 0) {
+            m_strings.resize(m_term.stringOffset);
+            return;
+        }
+        m_term.postingsSize = static_cast<uint32_t>(m_postings.size() - m_term.postingsOffset);
+        m_terms.push_back(m_term);
+    }
+
+    std::string Finish(uint32_t firstDoc, uint32_t lastDoc) const {
+        Header h = {};
+        memcpy(h.magic, kMagic, sizeof(kMagic));
+        h.version = kVersion;
+        h.firstDoc = firstDoc;
+        h.lastDoc = lastDoc;
+        h.docCount = static_cast<uint32_t>(m_docs.size());
+        h.termCount = static_cast<uint32_t>(m_terms.size());
+        h.totalLength = m_totalLength;
+        h.termsOffset = sizeof(Header) + m_docs.size() * sizeof(DocEntry);
+        h.stringsOffset = h.termsOffset + m_terms.size() * sizeof(TermEntry);
+        h.postingsOffset = h.stringsOffset + m_strings.size();
+        h.size = h.postingsOffset + m_postings.size();
+        std::string out;
+        out.reserve(h.size);
+        out.append(reinterpret_cast<const char*>(&h), sizeof(h));
+        out.append(reinterpret_cast<const char*>(m_docs.data()), m_docs.size() * sizeof(DocEntry));
+        out.append(reinterpret_cast<const char*>(m_terms.data()), m_terms.size() * sizeof(TermEntry));
+        out += m_strings;
+        out += m_postings;
+        return out;
+    }
+
+private:
+    std::vector<DocEntry> m_docs;
+    std::vector<TermEntry> m_terms;
+    std::string m_strings;
+    std::string m_postings;
+    uint64_t m_totalLength = 0;
+    TermEntry m_term = {};
+    uint32_t m_nextIndex = 0;
+};
+
+std::string SegmentName(uint32_t firstDoc, uint32_t lastDoc) {
+    char name[64];
+    snprintf(name, sizeof(name), "index-%08" PRIx32 "-%08" PRIx32 ".sbix", firstDoc, lastDoc);
+    return name;
+}
+
+bool WriteFile(const std::string& path, const std::string& bytes) {
+    std::string tmp = path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size();
+    ok = fclose(f) == 0 && ok;
+    if (ok) ok = rename(tmp.c_str(), path.c_str()) == 0;
+    if (!ok) unlink(tmp.c_str());
+    return ok;
+}
+
+}  // namespace
+
+struct TextIndex::Segment {
+    std::string path;    // its file; empty when nothing is on disk
+    std::string memory;  // the bytes when not mapped from path
+    bool mapped = false;
+    const char* data = nullptr;
+    size_t size = 0;
+    const Header* header = nullptr;
+    const DocEntry* docs = nullptr;
+    const TermEntry* terms = nullptr;
+    const char* strings = nullptr;
+    const unsigned char* postings = nullptr;
+
+    ~Segment() {
+        if (mapped) munmap(const_cast<char*>(data), size);
+    }
+
+    // Maps file read-only. False if it cannot be mapped, or, with damaged
+    // set, if it does not hold a well-formed segment.
+    bool Map(const std::string& file, bool* damaged = nullptr) {
+        int fd = open(file.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) {
+            if (fd >= 0) close(fd);
+            return false;
+        }
+        void* bytes = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (bytes == MAP_FAILED) return false;
+        if (!Attach(static_cast<const char*>(bytes), st.st_size)) {
+            munmap(bytes, st.st_size);
+            if (damaged) *damaged = true;
+            return false;
+        }
+        mapped = true;
+        return true;
+    }
+
+    // Keeps bytes in memory, for a segment that could not be written.
+    void Hold(std::string bytes) {
+        memory = std::move(bytes);
+        Attach(memory.data(), memory.size());
+    }
+
+    // Checks the layout so a damaged file cannot send lookups out of bounds.
+    bool Attach(const char* bytes, size_t length) {
+        data = bytes;
+        size = length;
+        if (size < sizeof(Header)) return false;
+        header = reinterpret_cast<const Header*>(data);
+        const Header& h = *header;
+        if (memcmp(h.magic, kMagic, sizeof(kMagic)) != 0 || h.version != kVersion || h.size != size) return false;
+        if (h.termsOffset != sizeof(Header) + uint64_t(h.docCount) * sizeof(DocEntry) ||
+            h.stringsOffset != h.termsOffset + uint64_t(h.termCount) * sizeof(TermEntry) ||
+            h.postingsOffset < h.stringsOffset || h.postingsOffset > size) {
+            return false;
+        }
+        docs = reinterpret_cast<const DocEntry*>(data + sizeof(Header));
+        terms = reinterpret_cast<const TermEntry*>(data + h.termsOffset);
+        strings = data + h.stringsOffset;
+        postings = reinterpret_cast<const unsigned char*>(data + h.postingsOffset);
+        uint64_t stringsSize = h.postingsOffset - h.stringsOffset;
+        uint64_t postingsSize = size - h.postingsOffset;
+        for (uint32_t i = 0; i < h.termCount; i++) {
+            const TermEntry& t = terms[i];
+            if (uint64_t(t.stringOffset) + t.stringSize > stringsSize ||
+                t.postingsOffset + t.postingsSize > postingsSize || t.docFreq > h.docCount) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::string_view Term(const TermEntry& t) const { return std::string_view(strings + t.stringOffset, t.stringSize); }
+
+    // Term entries equal to term, or starting with it when prefix is set.
+    std::pair<const TermEntry*, const TermEntry*> Find(std::string_view term, bool prefix) const {
+        const TermEntry* begin = terms;
+        const TermEntry* end = terms + header->termCount;
+        const TermEntry* first = std::lower_bound(begin, end, term, [&](const TermEntry& t, std::string_view key) {
+            return Term(t) < key;
+        });
+        const TermEntry* last = first;
+        if (prefix) {
+            while (last != end && Term(*last).substr(0, term.size()) == term) last++;
+        } else if (last != end && Term(*last) == term) {
+            last++;
+        }
+        return {first, last};
+    }
+
+    // Calls fn(docIndex, tf) for each posting of t.
+    template <typename Fn>
+    void ForEachPosting(const TermEntry& t, Fn&& fn) const {
+        const unsigned char* p = postings + t.postingsOffset;
+        const unsigned char* end = p + t.postingsSize;
+        uint32_t next = 0;
+        while (p < end) {
+            uint32_t index = next + GetVarint(p, end);
+            uint32_t tf = GetVarint(p, end);
+            if (index >= header->docCount) return;
+            fn(index, tf);
+            next = index + 1;
+        }
+    }
+};
+
+TextIndex::TextIndex(std::string dir, std::function<bool(uint32_t doc)> live)
+    : m_dir(std::move(dir)), m_live(std::move(live)) {
+    if (!m_dir.empty()) Open();
+    m_published = std::make_shared<const SegmentList>(m_segments);
+    m_thread = std::thread(&TextIndex::IndexThread, this);
+}
+
+// Maps the segments already in m_dir.
+void TextIndex::Open() {
+    mkdir(m_dir.c_str(), 0755);
+    DIR* d = opendir(m_dir.c_str());
+    if (!d) return;
+    struct Found {
+        uint32_t first, last;
+        std::string name;
+    };
+    std::vector<Found> found;
+    while (dirent* e = readdir(d)) {
+        unsigned first, last;
+        int used = 0;
+        if (sscanf(e->d_name, "index-%8x-%8x.sbix%n", &first, &last, &used) == 2 && e->d_name[used] == '\0') {
+            found.push_back({first, last, e->d_name});
+        } else if (strncmp(e->d_name, "index-", 6) == 0 && strstr(e->d_name, ".tmp")) {
+            unlink((m_dir + "/" + e->d_name).c_str());  // an interrupted write
+        }
+    }
+    closedir(d);
+
+    // A merge that was cut short leaves its inputs next to its output; the
+    // output covers their whole range, so they can go.
+    std::sort(found.begin(), found.end(), [](const Found& a, const Found& b) {
+        return a.first != b.first ? a.first < b.first : a.last > b.last;
+    });
+    uint32_t covered = 0;
+    bool any = false;
+    for (const Found& f : found) {
+        std::string path = m_dir + "/" + f.name;
+        if (any && f.first <= covered) {
+            unlink(path.c_str());
+            continue;
+        }
+        auto segment = std::make_shared<Segment>();
+        bool damaged = false;
+        if (!segment->Map(path, &damaged)) {
+            if (damaged) {
+                std::cerr << "[History] Dropping damaged index segment " << f.name << std::endl;
+                unlink(path.c_str());
+            }
+            continue;
+        }
+        segment->path = path;
+        m_segments.push_back(std::move(segment));
+        covered = f.last;
+        any = true;
+    }
+}
+
+TextIndex::~TextIndex() {
+    // documents still queued are indexed first so no visit is lost
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_queueCv.notify_one();
+    m_thread.join();
+}
+
+std::shared_ptr<const TextIndex::SegmentList> TextIndex::Segments() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_published;
+}
+
+uint32_t TextIndex::LastDoc() const {
+    std::shared_ptr<const SegmentList> segments = Segments();
+    return segments->empty() ? 0 : segments->back()->header->lastDoc;
+}
+
+size_t TextIndex::DocCount() const {
+    size_t count = 0;
+    for (const auto& segment : *Segments()) count += segment->header->docCount;
+    return count;
+}
+
+void TextIndex::Add(uint32_t doc, std::string text) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.emplace_back(doc, std::move(text));
+    }
+    m_queueCv.notify_one();
+}
+
+void TextIndex::IndexThread() {
+    while (true) {
+        std::pair<uint32_t, std::string> job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_queueCv.wait(lock, [&] { return m_quit || !m_queue.empty(); });
+            if (m_queue.empty()) return;
+            job = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        Index(job.first, job.second);
+        // Search keeps reading the list it took, and the segments in it,
+        // while merges replace them here
+        auto published = std::make_shared<const SegmentList>(m_segments);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_published = std::move(published);
+    }
+}
+
+void TextIndex::Index(uint32_t doc, std::string_view text) {
+    TRACE_SCOPE("history", "TextIndex::Index");
+    std::unordered_map<std::string, uint32_t> counts;
+    uint32_t length = 0;
+    ForEachTerm(text, [&](std::string_view term) {
+        counts[std::string(term)]++;
+        length++;
+    });
+    if (length == 0) return;
+    std::vector<const std::pair<const std::string, uint32_t>*> sorted;
+    sorted.reserve(counts.size());
+    for (const auto& entry : counts) sorted.push_back(&entry);
+    std::sort(sorted.begin(), sorted.end(), [](auto* a, auto* b) { return a->first < b->first; });
+
+    SegmentBuilder builder;
+    builder.AddDoc(doc, length);
+    for (auto* entry : sorted) {
+        builder.BeginTerm(entry->first);
+        builder.AddPosting(0, entry->second);
+        builder.EndTerm();
+    }
+
+    auto segment = std::make_shared<Segment>();
+    std::string bytes = builder.Finish(doc, doc);
+    if (!m_dir.empty()) {
+        segment->path = m_dir + "/" + SegmentName(doc, doc);
+        if (!WriteFile(segment->path, bytes)) {
+            std::cerr << "[History] Cannot write " << segment->path << std::endl;
+            segment->path.clear();
+        }
+    }
+    if (segment->path.empty() || !segment->Map(segment->path)) segment->Hold(std::move(bytes));
+    m_segments.push_back(std::move(segment));
+
+    // fold runs of same-sized segments so lookups touch only a few
+    while (true) {
+        size_t n = m_segments.size();
+        int tier = Tier(m_segments.back()->header->docCount);
+        if (tier >= kMaxMergeTier) break;
+        size_t first = n;
+        while (first > 0 && Tier(m_segments[first - 1]->header->docCount) == tier) first--;
+        if (n - first < kMergeWidth) break;
+        Merge(first);
+    }
+}
+
+void TextIndex::Merge(size_t first) {
+    TRACE_SCOPE("history", "TextIndex::Merge");
+    SegmentList inputs;
+    for (size_t i = first; i < m_segments.size(); i++) inputs.push_back(std::move(m_segments[i]));
+    m_segments.resize(first);
+
+    SegmentBuilder builder;
+    std::vector<std::vector<int64_t>> remap(inputs.size());
+    for (size_t s = 0; s < inputs.size(); s++) {
+        const Segment& in = *inputs[s];
+        remap[s].assign(in.header->docCount, -1);
+        for (uint32_t i = 0; i < in.header->docCount; i++) {
+            if (!m_live(in.docs[i].doc)) continue;
+            remap[s][i] = builder.DocCount();
+            builder.AddDoc(in.docs[i].doc, in.docs[i].length);
+        }
+    }
+
+    // k-way merge of the sorted term tables; inputs are in document order,
+    // so appending their postings in turn keeps each list ascending
+    std::vector<uint32_t> cursor(inputs.size(), 0);
+    while (true) {
+        std::string_view smallest;
+        bool found = false;
+        for (size_t s = 0; s < inputs.size(); s++) {
+            if (cursor[s] == inputs[s]->header->termCount) continue;
+            std::string_view term = inputs[s]->Term(inputs[s]->terms[cursor[s]]);
+            if (!found || term < smallest) smallest = term;
+            found = true;
+        }
+        if (!found) break;
+        std::string term(smallest);
+        builder.BeginTerm(term);
+        for (size_t s = 0; s < inputs.size(); s++) {
+            if (cursor[s] == inputs[s]->header->termCount) continue;
+            const TermEntry& t = inputs[s]->terms[cursor[s]];
+            if (inputs[s]->Term(t) != term) continue;
+            inputs[s]->ForEachPosting(t, [&](uint32_t index, uint32_t tf) {
+                if (remap[s][index] >= 0) builder.AddPosting(static_cast<uint32_t>(remap[s][index]), tf);
+            });
+            cursor[s]++;
+        }
+        builder.EndTerm();
+    }
+
+    uint32_t firstDoc = inputs.front()->header->firstDoc;
+    uint32_t lastDoc = inputs.back()->header->lastDoc;
+    std::string path = m_dir.empty() ? "" : m_dir + "/" + SegmentName(firstDoc, lastDoc);
+    std::string bytes = builder.DocCount() ? builder.Finish(firstDoc, lastDoc) : std::string();
+    if (!path.empty() && !bytes.empty() && !WriteFile(path, bytes)) {
+        // the inputs stay on disk and are merged again next run
+        std::cerr << "[History] Cannot write " << path << std::endl;
+        path.clear();
+    } else {
+        // the output replaced any input of the same name when it was renamed into place
+        for (const auto& in : inputs) {
+            if (!in->path.empty() && in->path != path) unlink(in->path.c_str());
+        }
+    }
+    if (bytes.empty()) return;
+
+    // mapped rather than held, so a large merged segment costs page cache
+    // the kernel can reclaim instead of heap
+    auto segment = std::make_shared<Segment>();
+    segment->path = path;
+    if (path.empty() || !segment->Map(path)) segment->Hold(std::move(bytes));
+    m_segments.push_back(std::move(segment));
+}
+
+std::vector<TextIndex::Hit> TextIndex::Search(std::string_view query, size_t limit) const {
+    std::vector<std::string> terms;
+    ForEachTerm(query, [&](std::string_view term) {
+        if (terms.size() < kMaxQueryTerms) terms.emplace_back(term);
+    });
+    std::vector<Hit> hits;
+    std::shared_ptr<const SegmentList> segments = Segments();
+    if (terms.empty() || segments->empty() || limit == 0) return hits;
+    unsigned char lastChar = static_cast<unsigned char>(query.back());
+    bool prefix = lastChar >= 0x80 || isalnum(lastChar);
+
+    uint64_t totalLength = 0;
+    size_t docCount = 0;
+    for (const auto& segment : *segments) {
+        totalLength += segment->header->totalLength;
+        docCount += segment->header->docCount;
+    }
+    const float avgLength = docCount ? static_cast<float>(totalLength) / docCount : 1.0f;
+
+    // every term entry the query touches, and document frequencies summed
+    // over segments so idf is the same wherever a term lives
+    struct Match {
+        const Segment* segment;
+        const TermEntry* entry;
+        uint32_t queryTerm;
+    };
+    std::vector<Match> matches;
+    std::unordered_map<std::string_view, uint32_t> docFreq;
+    for (const auto& segment : *segments) {
+        for (uint32_t q = 0; q < terms.size(); q++) {
+            bool isPrefix = prefix && q + 1 == terms.size();
+            auto [first, last] = segment->Find(terms[q], isPrefix);
+            std::vector<const TermEntry*> found;
+            for (const TermEntry* t = first; t != last; t++) found.push_back(t);
+            if (found.size() > kMaxPrefixTerms) {
+                std::partial_sort(found.begin(), found.begin() + kMaxPrefixTerms, found.end(),
+                                  [](const TermEntry* a, const TermEntry* b) { return a->docFreq > b->docFreq; });
+                found.resize(kMaxPrefixTerms);
+            }
+            for (const TermEntry* t : found) {
+                matches.push_back({segment.get(), t, q});
+                docFreq[segment->Term(*t)] += t->docFreq;
+            }
+        }
+    }
+
+    const uint32_t allTerms = (terms.size() == 32 ? 0u : (1u << terms.size())) - 1;
+    std::vector<float> score;
+    std::vector<uint32_t> seen;
+    for (const auto& segment : *segments) {
+        bool any = false;
+        for (const Match& m : matches) any |= m.segment == segment.get();
+        if (!any) continue;
+        score.assign(segment->header->docCount, 0.0f);
+        seen.assign(segment->header->docCount, 0);
+        for (const Match& m : matches) {
+            if (m.segment != segment.get()) continue;
+            float df = static_cast<float>(docFreq[segment->Term(*m.entry)]);
+            float idf = std::log(1.0f + (docCount - df + 0.5f) / (df + 0.5f));
+            segment->ForEachPosting(*m.entry, [&](uint32_t index, uint32_t tf) {
+                float length = static_cast<float>(segment->docs[index].length);
+                score[index] += idf * tf * (kK1 + 1) / (tf + kK1 * (1 - kB + kB * length / avgLength));
+                seen[index] |= 1u << m.queryTerm;
+            });
+        }
+        for (uint32_t i = 0; i < segment->header->docCount; i++) {
+            if (seen[i] == allTerms && m_live(segment->docs[i].doc)) hits.push_back({segment->docs[i].doc, score[i]});
+        }
+    }
+
+    auto better = [](const Hit& a, const Hit& b) { return a.score > b.score; };
+    if (hits.size() > limit) {
+        std::partial_sort(hits.begin(), hits.begin() + limit, hits.end(), better);
+        hits.resize(limit);
+    } else {
+        std::sort(hits.begin(), hits.end(), better);
+    }
+    return hits;
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "encoding.h"
+
+// Calls fn(term) for each index term of text: runs of ASCII letters and
+// digits and of non-ASCII bytes, case-folded. Terms under 2 or over 64
+// bytes are skipped.
+template <typename Fn>
+void ForEachTerm(std::string_view text, Fn&& fn) {
+    auto isWord = [](unsigned char c) {
+        return c >= 0x80 || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+    };
+    char folded[64];
+    size_t i = 0;
+    while (i < text.size()) {
+        while (i < text.size() && !isWord(static_cast<unsigned char>(text[i]))) i++;
+        size_t start = i;
+        while (i < text.size() && isWord(static_cast<unsigned char>(text[i]))) i++;
+        size_t length = i - start;
+        if (length < 2 || length > sizeof(folded)) continue;
+        FoldCase(text.data() + start, length, folded);
+        fn(std::string_view(folded, length));
+    }
+}
+
+// Full-text index of documents numbered by increasing uint32 ids. Each added
+// document becomes a small immutable segment file in dir; segments are
+// memory-mapped, and whenever four of the same size class pile up they are
+// merged into one, dropping documents the live filter no longer wants.
+// Tokenizing, writing and merging happen on a background thread, so a
+// document shows up in Search a moment after Add returns.
+//
+// A segment holds a sorted term table and, per term, a posting list of
+// varint-coded (document delta, term frequency) pairs. Queries are ranked
+// with BM25.
+class TextIndex {
+public:
+    struct Hit {
+        uint32_t doc;
+        float score;
+    };
+
+    // An empty dir keeps nothing on disk. live(doc) decides which documents
+    // survive a merge and may appear in results; it must stay callable for
+    // the index's lifetime and is called from the index thread too.
+    TextIndex(std::string dir, std::function<bool(uint32_t doc)> live);
+    ~TextIndex();
+    TextIndex(const TextIndex&) = delete;
+    TextIndex& operator=(const TextIndex&) = delete;
+
+    // Queues text for indexing. doc must be above every id added before.
+    void Add(uint32_t doc, std::string text);
+
+    // Best live documents containing every term of query, best first. The
+    // last term also matches as a prefix unless the query ends in a space,
+    // so results keep up while the query is typed.
+    std::vector<Hit> Search(std::string_view query, size_t limit) const;
+
+    uint32_t LastDoc() const;  // 0 when empty; queued documents not counted
+    size_t DocCount() const;   // including documents not yet merged away
+
+private:
+    struct Segment;
+    using SegmentList = std::vector<std::shared_ptr<Segment>>;  // by doc range, oldest first
+
+    void Open();
+    void IndexThread();
+    void Index(uint32_t doc, std::string_view text);
+    void Merge(size_t first);
+    std::shared_ptr<const SegmentList> Segments() const;
+
+    std::string m_dir;
+    std::function<bool(uint32_t)> m_live;
+    SegmentList m_segments;  // the index thread's working copy
+
+    mutable std::mutex m_mutex;
+    std::shared_ptr<const SegmentList> m_published;  // what Search reads
+    std::deque<std::pair<uint32_t, std::string>> m_queue;
+    std::condition_variable m_queueCv;
+    bool m_quit = false;
+    std::thread m_thread;
+};
@@ -0,0 +1,217 @@
+#include "trace.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <vector>
+#include <thread>
+#include <functional>
+
+namespace trace {
+
+namespace {
+
+enum class Phase : uint8_t { Complete, Async, Instant };
+
+struct Event {
+    const char* category;
+    const char* name;
+    int64_t start;
+    int64_t duration;
+    uint64_t id;
+    Phase phase;
+    char arg[87];
+};
+
+// An event in the ring, held in relaxed atomic words so WriteJSON may read
+// it while its thread overwrites it; seq tells whether that happened.
+struct Slot {
+    std::atomic<uint64_t> seq{0};  // 2n+1 while event n is written, 2n+2 once it is whole
+    std::atomic<uint64_t> words[sizeof(Event) / 8];
+};
+static_assert(sizeof(Event) % 8 == 0, "Event is copied in 8-byte words");
+
+const size_t kRingSize = 16384;  // events per thread, ~2 MiB
+
+struct ThreadBuffer {
+    uint64_t tid = 0;
+    std::string name;
+    std::atomic<uint64_t> written{0};
+    Slot slots[kRingSize];
+};
+
+const auto g_epoch = std::chrono::steady_clock::now();
+std::atomic<bool> g_enabled{true};
+std::mutex g_registryMutex;
+std::vector<ThreadBuffer*> g_buffers;  // never freed: threads may outlive the dump
+
+ThreadBuffer& LocalBuffer() {
+    thread_local ThreadBuffer* buffer = [] {
+        auto* b = new ThreadBuffer;
+        b->tid = std::hash<std::thread::id>()(std::this_thread::get_id()) & 0xFFFFFF;
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        g_buffers.push_back(b);
+        return b;
+    }();
+    return *buffer;
+}
+
+void Push(Phase phase, const char* category, const char* name, uint64_t id,
+          int64_t start, int64_t duration, const char* arg) {
+    if (!g_enabled.load(std::memory_order_relaxed)) return;
+    ThreadBuffer& buffer = LocalBuffer();
+    uint64_t index = buffer.written.load(std::memory_order_relaxed);
+    Event e;
+    e.category = category;
+    e.name = name;
+    e.start = start;
+    e.duration = duration;
+    e.id = id;
+    e.phase = phase;
+    size_t length = 0;
+    if (arg) {
+        length = strnlen(arg, sizeof(e.arg) - 1);
+        // cut before the lead byte of a UTF-8 sequence that would not fit
+        if (arg[length] != '\0') {
+            while (length > 0 && (static_cast<unsigned char>(arg[length]) & 0xC0) == 0x80) length--;
+        }
+        memcpy(e.arg, arg, length);
+    }
+    memset(e.arg + length, 0, sizeof(e.arg) - length);
+
+    uint64_t words[sizeof(Event) / 8];
+    memcpy(words, &e, sizeof(e));
+    Slot& slot = buffer.slots[index % kRingSize];
+    slot.seq.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < sizeof(Event) / 8; i++) slot.words[i].store(words[i], std::memory_order_relaxed);
+    slot.seq.store(2 * index + 2, std::memory_order_release);
+    buffer.written.store(index + 1, std::memory_order_release);
+}
+
+// Copies event index out of buffer, unless its slot is being written or
+// already holds a later event.
+bool ReadEvent(const ThreadBuffer& buffer, uint64_t index, Event& e) {
+    const Slot& slot = buffer.slots[index % kRingSize];
+    uint64_t seq = slot.seq.load(std::memory_order_acquire);
+    if (seq != 2 * index + 2) return false;
+    uint64_t words[sizeof(Event) / 8];
+    for (size_t i = 0; i < sizeof(Event) / 8; i++) words[i] = slot.words[i].load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.seq.load(std::memory_order_relaxed) != seq) return false;
+    memcpy(&e, words, sizeof(e));
+    return true;
+}
+
+void WriteEscaped(FILE* f, const char* s) {
+    for (; *s; s++) {
+        unsigned char c = static_cast<unsigned char>(*s);
+        if (c == '"' || c == '\\') {
+            fputc('\\', f);
+            fputc(c, f);
+        } else if (c < 0x20) {
+            fprintf(f, "\\u%04x", c);
+        } else {
+            fputc(c, f);
+        }
+    }
+}
+
+void WriteCommon(FILE* f, const Event& e, uint64_t tid) {
+    fputs("{\"cat\":\"", f);
+    WriteEscaped(f, e.category);
+    fputs("\",\"name\":\"", f);
+    WriteEscaped(f, e.name);
+    fprintf(f, "\",\"pid\":1,\"tid\":%llu", static_cast<unsigned long long>(tid));
+    if (e.arg[0]) {
+        fputs(",\"args\":{\"detail\":\"", f);
+        WriteEscaped(f, e.arg);
+        fputs("\"}", f);
+    }
+}
+
+}  // namespace
+
+int64_t NowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - g_epoch).count();
+}
+
+void SetEnabled(bool enabled) { g_enabled = enabled; }
+bool Enabled() { return g_enabled.load(std::memory_order_relaxed); }
+
+void SetThreadName(const char* name) {
+    ThreadBuffer& buffer = LocalBuffer();
+    std::lock_guard<std::mutex> lock(g_registryMutex);
+    buffer.name = name;
+}
+
+void Complete(const char* category, const char* name, int64_t startUs, int64_t durUs, const char* arg) {
+    Push(Phase::Complete, category, name, 0, startUs, durUs, arg);
+}
+
+void Async(const char* category, const char* name, uint64_t id, int64_t startUs, int64_t durUs, const char* arg) {
+    Push(Phase::Async, category, name, id, startUs, durUs, arg);
+}
+
+void Instant(const char* category, const char* name, const char* arg) {
+    Push(Phase::Instant, category, name, 0, NowUs(), 0, arg);
+}
+
+bool WriteJSON(const std::string& path) {
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f) return false;
+
+    std::vector<Event> events;
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", f);
+    bool first = true;
+    std::lock_guard<std::mutex> lock(g_registryMutex);
+    for (ThreadBuffer* buffer : g_buffers) {
+        if (!buffer->name.empty()) {
+            fprintf(f, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%llu,\"args\":{\"name\":\"",
+                    first ? "" : ",\n", static_cast<unsigned long long>(buffer->tid));
+            WriteEscaped(f, buffer->name.c_str());
+            fputs("\"}}", f);
+            first = false;
+        }
+
+        // Copy the live window; the owning thread may keep writing meanwhile,
+        // and the oldest few events it overwrites are left out.
+        uint64_t written = buffer->written.load(std::memory_order_acquire);
+        uint64_t begin = written > kRingSize ? written - kRingSize : 0;
+        events.clear();
+        Event e;
+        for (uint64_t i = begin; i < written; i++) {
+            if (ReadEvent(*buffer, i, e)) events.push_back(e);
+        }
+
+        for (const Event& e : events) {
+            fputs(first ? "" : ",\n", f);
+            first = false;
+            switch (e.phase) {
+            case Phase::Complete:
+                WriteCommon(f, e, buffer->tid);
+                fprintf(f, ",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld}",
+                        static_cast<long long>(e.start), static_cast<long long>(e.duration));
+                break;
+            case Phase::Async:
+                WriteCommon(f, e, buffer->tid);
+                fprintf(f, ",\"ph\":\"b\",\"id\":%llu,\"ts\":%lld},\n",
+                        static_cast<unsigned long long>(e.id), static_cast<long long>(e.start));
+                WriteCommon(f, e, buffer->tid);
+                fprintf(f, ",\"ph\":\"e\",\"id\":%llu,\"ts\":%lld}",
+                        static_cast<unsigned long long>(e.id), static_cast<long long>(e.start + e.duration));
+                break;
+            case Phase::Instant:
+                WriteCommon(f, e, buffer->tid);
+                fprintf(f, ",\"ph\":\"i\",\"s\":\"t\",\"ts\":%lld}", static_cast<long long>(e.start));
+                break;
+            }
+        }
+    }
+    fputs("\n]}\n", f);
+    return fclose(f) == 0;
+}
+
+}  // namespace trace
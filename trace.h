@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Low-overhead page-load tracing. Each thread records into its own fixed-size
+// ring buffer (no locks on the hot path, oldest events are overwritten), and
+// WriteJSON() dumps everything as Chrome trace-event JSON that loads in
+// chrome://tracing or ui.perfetto.dev.
+//
+// Event names and categories must be string literals; they are stored by
+// pointer. Free-form detail (a URL, a size) goes in the short `arg` string.
+namespace trace {
+
+int64_t NowUs();  // microseconds since process start
+
+void SetEnabled(bool enabled);
+bool Enabled();
+void SetThreadName(const char* name);
+
+// A span on the calling thread. Spans on one thread must nest.
+void Complete(const char* category, const char* name, int64_t startUs, int64_t durUs,
+              const char* arg = nullptr);
+// A span that may overlap others, e.g. concurrent transfers. Spans sharing
+// an id are drawn on one track.
+void Async(const char* category, const char* name, uint64_t id, int64_t startUs, int64_t durUs,
+           const char* arg = nullptr);
+// A point in time, e.g. first paint.
+void Instant(const char* category, const char* name, const char* arg = nullptr);
+
+bool WriteJSON(const std::string& path);
+
+class Scope {
+public:
+    Scope(const char* category, const char* name, const char* arg = nullptr)
+        : m_category(category), m_name(name), m_arg(arg), m_start(Enabled() ? NowUs() : -1) {}
+    ~Scope() {
+        if (m_start >= 0) Complete(m_category, m_name, m_start, NowUs() - m_start, m_arg);
+    }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    const char* m_category;
+    const char* m_name;
+    const char* m_arg;
+    int64_t m_start;
+};
+
+}  // namespace trace
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(category, name) trace::Scope TRACE_CONCAT(traceScope_, __LINE__)(category, name)
+#define TRACE_SCOPE_ARG(category, name, arg) trace::Scope TRACE_CONCAT(traceScope_, __LINE__)(category, name, arg)
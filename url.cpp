@@ -0,0 +1,432 @@
+#include "url.h"
+#include <cstring>
+#include "data_uri.h"
+
+// A reference split per RFC 3986 appendix B, as views into the input.
+struct URL::Parts {
+    std::string_view scheme, authority, path, query, fragment;
+    bool hasScheme = false;
+    bool hasAuthority = false;
+    bool hasQuery = false;
+    bool hasFragment = false;
+    bool canonicalAuthority = false;  // taken from a URL, so already normalized,
+    size_t hostBegin = 0, hostEnd = 0;  // with the host at these offsets into it
+};
+
+static bool IsAlpha(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static int HexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool IsUnreserved(unsigned char c) {
+    return IsAlpha(c) || (c >= '0' && c <= '9') || c == '-' || c == '.' || c == '_' || c == '~';
+}
+
+static char ToLower(char c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+// Leading and trailing spaces and controls are not part of a URL in markup.
+static std::string_view Trim(std::string_view s) {
+    while (!s.empty() && static_cast<unsigned char>(s.front()) <= ' ') s.remove_prefix(1);
+    while (!s.empty() && static_cast<unsigned char>(s.back()) <= ' ') s.remove_suffix(1);
+    return s;
+}
+
+void URL::Split(std::string_view s, Parts& out) {
+    out = Parts();
+    s = Trim(s);
+    // tabs and line breaks inside are dropped before anything else; markup
+    // wraps long URLs
+    bool hasBreaks = false;
+    for (char c : s) hasBreaks |= c == '\t' || c == '\n' || c == '\r';
+    if (hasBreaks) {
+        thread_local std::string stripped;
+        stripped.clear();
+        for (char c : s) {
+            if (c != '\t' && c != '\n' && c != '\r') stripped += c;
+        }
+        s = stripped;
+    }
+    if (!s.empty() && IsAlpha(s[0])) {
+        size_t i = 1;
+        while (i < s.size() && (IsAlpha(s[i]) || (s[i] >= '0' && s[i] <= '9') || s[i] == '+' || s[i] == '-' || s[i] == '.')) i++;
+        if (i < s.size() && s[i] == ':') {
+            out.hasScheme = true;
+            out.scheme = s.substr(0, i);
+            s.remove_prefix(i + 1);
+        }
+    }
+    if (s.size() >= 2 && s[0] == '/' && s[1] == '/') {
+        size_t end = 2;
+        while (end < s.size() && s[end] != '/' && s[end] != '?' && s[end] != '#') end++;
+        out.hasAuthority = true;
+        out.authority = s.substr(2, end - 2);
+        s.remove_prefix(end);
+    }
+    size_t end = 0;
+    while (end < s.size() && s[end] != '?' && s[end] != '#') end++;
+    out.path = s.substr(0, end);
+    s.remove_prefix(end);
+    if (!s.empty() && s[0] == '?') {
+        end = s.find('#');
+        if (end == std::string_view::npos) end = s.size();
+        out.hasQuery = true;
+        out.query = s.substr(1, end - 1);
+        s.remove_prefix(end);
+    }
+    if (!s.empty()) {
+        out.hasFragment = true;
+        out.fragment = s.substr(1);
+    }
+}
+
+// Bytes that go into a path, query or fragment as they are.
+static const struct PlainBytes {
+    bool table[256] = {};
+    PlainBytes() {
+        for (int c = '!'; c < 0x7F; c++) table[c] = c != '%' && c != '"' && c != '<' && c != '>';
+    }
+} kPlain;
+
+// Appends s with escapes normalized: unreserved characters decoded, other
+// escapes in uppercase, bytes that may not appear raw escaped. Hosts keep
+// non-ASCII bytes (IDNs are the network library's business) and are lowercased.
+static void AppendNormalized(std::string& out, std::string_view s, bool host = false) {
+    static const char hex[] = "0123456789ABCDEF";
+    for (size_t i = 0; i < s.size(); i++) {
+        if (!host) {
+            size_t run = i;
+            while (run < s.size() && kPlain.table[static_cast<unsigned char>(s[run])]) run++;
+            out.append(s.data() + i, run - i);
+            i = run;
+            if (i == s.size()) break;
+        }
+        unsigned char c = static_cast<unsigned char>(s[i]);
+        if (c == '%' && i + 2 < s.size() && HexValue(s[i + 1]) >= 0 && HexValue(s[i + 2]) >= 0) {
+            unsigned char decoded = static_cast<unsigned char>(HexValue(s[i + 1]) * 16 + HexValue(s[i + 2]));
+            i += 2;
+            if (IsUnreserved(decoded)) {
+                out += host ? ToLower(static_cast<char>(decoded)) : static_cast<char>(decoded);
+                continue;
+            }
+            c = decoded;
+        } else if (host && (c >= 0x80 || kPlain.table[c])) {
+            out += ToLower(static_cast<char>(c));
+            continue;
+        }
+        out += '%';
+        out += hex[c >> 4];
+        out += hex[c & 15];
+    }
+}
+
+// RFC 3986 section 5.2.4 over path[0, size), in place; returns the new size.
+static size_t RemoveDotSegments(char* path, size_t size) {
+    size_t r = 0, w = 0;
+    auto startsWith = [&](const char* prefix, size_t length) {
+        return size - r >= length && memcmp(path + r, prefix, length) == 0;
+    };
+    auto restIs = [&](const char* rest, size_t length) {
+        return size - r == length && memcmp(path + r, rest, length) == 0;
+    };
+    // drops the last output segment and the '/' before it
+    auto pop = [&] {
+        while (w > 0 && path[w - 1] != '/') w--;
+        if (w > 0) w--;
+    };
+    while (r < size) {
+        if (startsWith("../", 3)) {
+            r += 3;
+        } else if (startsWith("./", 2)) {
+            r += 2;
+        } else if (startsWith("/./", 3)) {
+            r += 2;
+        } else if (restIs("/.", 2)) {
+            path[w++] = '/';
+            r = size;
+        } else if (startsWith("/../", 4)) {
+            r += 3;
+            pop();
+        } else if (restIs("/..", 3)) {
+            r = size;
+            pop();
+            path[w++] = '/';
+        } else if (restIs(".", 1) || restIs("..", 2)) {
+            r = size;
+        } else {
+            do {
+                path[w++] = path[r++];
+            } while (r < size && path[r] != '/');
+        }
+    }
+    return w;
+}
+
+static std::string_view DefaultPort(std::string_view scheme) {
+    if (scheme == "http" || scheme == "ws") return "80";
+    if (scheme == "https" || scheme == "wss") return "443";
+    if (scheme == "ftp") return "21";
+    return {};
+}
+
+void URL::Build(const Parts& parts, std::string_view pathPrefix) {
+    m_spec.clear();
+    for (char c : parts.scheme) m_spec += ToLower(c);
+    m_schemeEnd = static_cast<uint32_t>(m_spec.size());
+    m_spec += ':';
+
+    m_hasAuthority = parts.hasAuthority;
+    if (parts.hasAuthority && parts.canonicalAuthority) {
+        m_spec += "//";
+        m_spec.append(parts.authority.data(), parts.authority.size());
+        m_hostBegin = static_cast<uint32_t>(m_schemeEnd + 3 + parts.hostBegin);
+        m_hostEnd = static_cast<uint32_t>(m_schemeEnd + 3 + parts.hostEnd);
+    } else if (parts.hasAuthority) {
+        m_spec += "//";
+        std::string_view hostPort = parts.authority;
+        size_t at = hostPort.rfind('@');
+        if (at != std::string_view::npos) {
+            AppendNormalized(m_spec, hostPort.substr(0, at));
+            m_spec += '@';
+            hostPort.remove_prefix(at + 1);
+        }
+        // the port follows the first ':' outside an IPv6 literal
+        size_t colon = hostPort.find(':', hostPort.empty() || hostPort[0] != '[' ? 0 : hostPort.find(']'));
+        m_hostBegin = static_cast<uint32_t>(m_spec.size());
+        AppendNormalized(m_spec, hostPort.substr(0, colon), true);
+        m_hostEnd = static_cast<uint32_t>(m_spec.size());
+        if (colon != std::string_view::npos) {
+            std::string_view port = hostPort.substr(colon + 1);
+            while (port.size() > 1 && port[0] == '0') port.remove_prefix(1);
+            if (!port.empty() && port != DefaultPort(Scheme())) {
+                m_spec += ':';
+                m_spec.append(port.data(), port.size());
+            }
+        }
+    } else {
+        m_hostBegin = m_hostEnd = static_cast<uint32_t>(m_spec.size());
+    }
+
+    m_pathBegin = static_cast<uint32_t>(m_spec.size());
+    std::string_view first = pathPrefix.empty() ? parts.path : pathPrefix;
+    bool opaque = !parts.hasAuthority && (first.empty() || first[0] != '/');
+    if (opaque) {
+        m_spec.append(pathPrefix.data(), pathPrefix.size());
+        m_spec.append(parts.path.data(), parts.path.size());
+    } else {
+        m_spec.append(pathPrefix.data(), pathPrefix.size());  // from a URL, already normalized
+        AppendNormalized(m_spec, parts.path);
+        size_t length = RemoveDotSegments(&m_spec[m_pathBegin], m_spec.size() - m_pathBegin);
+        m_spec.resize(m_pathBegin + length);
+        if (length == 0 && parts.hasAuthority && !DefaultPort(Scheme()).empty()) m_spec += '/';
+        // "//" would read back as an authority (RFC 3986 section 5.3)
+        if (!parts.hasAuthority && length >= 2 && m_spec[m_pathBegin + 1] == '/') m_spec.insert(m_pathBegin, "/.");
+    }
+
+    m_queryBegin = static_cast<uint32_t>(m_spec.size());
+    if (parts.hasQuery) {
+        m_spec += '?';
+        if (opaque) m_spec.append(parts.query.data(), parts.query.size());
+        else AppendNormalized(m_spec, parts.query);
+    }
+    m_fragmentBegin = static_cast<uint32_t>(m_spec.size());
+    if (parts.hasFragment) {
+        m_spec += '#';
+        if (opaque) m_spec.append(parts.fragment.data(), parts.fragment.size());
+        else AppendNormalized(m_spec, parts.fragment);
+    }
+}
+
+bool URL::Parse(std::string_view input) {
+    Parts parts;
+    Split(input, parts);
+    if (!parts.hasScheme || parts.scheme.empty()) {
+        m_spec.clear();
+        m_schemeEnd = 0;
+        return false;
+    }
+    Build(parts, {});
+    return true;
+}
+
+bool URL::Resolve(std::string_view reference, URL& out) const {
+    Parts ref;
+    Split(reference, ref);
+    if (ref.hasScheme) {
+        out.Build(ref, {});
+        return true;
+    }
+    if (!Valid()) {
+        out.m_spec.clear();
+        out.m_schemeEnd = 0;
+        return false;
+    }
+
+    Parts target;
+    target.hasScheme = true;
+    target.scheme = Scheme();
+    target.hasFragment = ref.hasFragment;
+    target.fragment = ref.fragment;
+    std::string_view prefix;
+    if (ref.hasAuthority) {
+        target.hasAuthority = true;
+        target.authority = ref.authority;
+        target.path = ref.path;
+        target.hasQuery = ref.hasQuery;
+        target.query = ref.query;
+    } else {
+        target.hasAuthority = m_hasAuthority;
+        if (m_hasAuthority) {
+            target.authority = Slice(m_schemeEnd + 3, m_pathBegin);
+            target.canonicalAuthority = true;
+            target.hostBegin = m_hostBegin - (m_schemeEnd + 3);
+            target.hostEnd = m_hostEnd - (m_schemeEnd + 3);
+        }
+        target.path = ref.path;
+        target.hasQuery = ref.hasQuery;
+        target.query = ref.query;
+        if (ref.path.empty()) {
+            target.path = Path();
+            if (!ref.hasQuery) {
+                target.hasQuery = HasQuery();
+                target.query = Query();
+            }
+        } else if (ref.path[0] != '/') {
+            // merge: the base path up to its last '/', then the reference
+            std::string_view base = Path();
+            if (m_hasAuthority && base.empty()) {
+                prefix = "/";
+            } else {
+                size_t slash = base.rfind('/');
+                prefix = slash == std::string_view::npos ? std::string_view() : base.substr(0, slash + 1);
+            }
+        }
+    }
+    out.Build(target, prefix);
+    return true;
+}
+
+std::string ResolveURL(const std::string& base, const std::string& relative) {
+    if (relative.empty()) return "";
+    if (IsDataURI(relative)) return relative;
+    URL baseURL, resolved;
+    if (!baseURL.Parse(base)) return resolved.Parse(relative) ? resolved.Spec() : relative;
+    return baseURL.Resolve(relative, resolved) ? resolved.Spec() : relative;
+}
+
+std::string_view URLCacheKey(std::string_view url) {
+    return IsDataURI(url) ? url : url.substr(0, url.find('#'));
+}
+
+// Eight bytes a step, as data URLs run to hundreds of kilobytes.
+static uint64_t HashURL(std::string_view s) {
+    const uint64_t kMul = 0x9E3779B97F4A7C15ull;
+    uint64_t h = s.size() * kMul;
+    size_t i = 0;
+    for (; i + 8 <= s.size(); i += 8) {
+        uint64_t word;
+        memcpy(&word, s.data() + i, 8);
+        h = (h ^ word) * kMul;
+        h ^= h >> 29;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, s.data() + i, s.size() - i);
+    h = (h ^ tail) * kMul;
+    return h ^ (h >> 32);
+}
+
+// Index of the slot holding key, or of the empty slot ending its probe run.
+size_t URLTable::FindSlot(std::string_view key, uint64_t hash) const {
+    size_t mask = m_slots.size() - 1;
+    size_t i = hash & mask;
+    for (; m_slots[i].id; i = (i + 1) & mask) {
+        if (m_slots[i].hash == hash && m_spellings[m_slots[i].id - 1] == key) break;
+    }
+    return i;
+}
+
+void URLTable::Grow() {
+    std::vector<Slot> old;
+    old.swap(m_slots);
+    m_slots.resize(old.empty() ? 64 : old.size() * 2);
+    size_t mask = m_slots.size() - 1;
+    for (const Slot& slot : old) {
+        if (!slot.id) continue;
+        size_t i = slot.hash & mask;
+        while (m_slots[i].id) i = (i + 1) & mask;
+        m_slots[i] = slot;
+    }
+}
+
+URLId URLTable::Intern(std::string_view url) {
+    std::string_view key = URLCacheKey(url);
+    if (key.empty()) return 0;
+    uint64_t hash = HashURL(key);
+    if (IsDataURI(key)) return kHashedURL | (hash & (kHashedURL - 1));
+    if ((m_count + 1) * 2 > m_slots.size()) Grow();
+    size_t i = FindSlot(key, hash);
+    if (m_slots[i].id) {
+        m_refs[m_slots[i].id - 1]++;
+        return m_slots[i].id;
+    }
+    URLId id;
+    if (!m_free.empty()) {
+        id = m_free.back();
+        m_free.pop_back();
+        m_spellings[id - 1].assign(key.data(), key.size());
+    } else {
+        m_spellings.emplace_back(key);
+        m_refs.push_back(0);
+        id = m_spellings.size();
+    }
+    m_refs[id - 1] = 1;
+    m_slots[i] = {hash, id};
+    m_count++;
+    return id;
+}
+
+URLId URLTable::Find(std::string_view url) const {
+    std::string_view key = URLCacheKey(url);
+    if (key.empty()) return 0;
+    uint64_t hash = HashURL(key);
+    if (IsDataURI(key)) return kHashedURL | (hash & (kHashedURL - 1));
+    return m_count ? m_slots[FindSlot(key, hash)].id : 0;
+}
+
+void URLTable::Release(URLId id) {
+    if (!id || id > m_refs.size() || !m_refs[id - 1] || --m_refs[id - 1]) return;
+    std::string& spelling = m_spellings[id - 1];
+    size_t hole = FindSlot(spelling, HashURL(spelling));
+    // backward shift, as in FlatMap::Erase
+    size_t mask = m_slots.size() - 1;
+    for (size_t i = (hole + 1) & mask; m_slots[i].id; i = (i + 1) & mask) {
+        if (((i - (m_slots[i].hash & mask)) & mask) >= ((i - hole) & mask)) {
+            m_slots[hole] = m_slots[i];
+            hole = i;
+        }
+    }
+    m_slots[hole] = Slot();
+    spelling.clear();
+    m_free.push_back(id);
+    m_count--;
+}
+
+void URLTable::Clear() {
+    m_slots.clear();
+    m_spellings.clear();
+    m_refs.clear();
+    m_free.clear();
+    m_count = 0;
+}
+
+const std::string& URLTable::Spelling(URLId id) const {
+    static const std::string kNone;
+    return id && id <= m_spellings.size() ? m_spellings[id - 1] : kNone;
+}
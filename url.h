@@ -0,0 +1,124 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// An absolute URL in canonical form, with the offsets of its components into
+// that one string. Canonical means RFC 3986 syntax-based normalization (scheme
+// and host lowercased, percent-escapes of unreserved characters decoded and
+// the rest uppercased, dot segments removed) plus the scheme-based kind:
+// default ports dropped and an empty http(s) path made "/". Spaces, controls
+// and non-ASCII bytes are percent-encoded, and tabs and line breaks dropped,
+// as browsers do with hand-written markup.
+//
+// URLs without an authority whose path does not start with "/" (data:,
+// mailto:, javascript:) are opaque and kept byte for byte.
+//
+// Parse and Resolve write into the URL they are called on or given, reusing
+// its buffer, so resolving many references with one output URL does not
+// allocate once the buffer has grown.
+class URL {
+public:
+    URL() = default;
+
+    // False, leaving the URL invalid, if input has no scheme.
+    bool Parse(std::string_view input);
+
+    // Resolves reference against this URL per RFC 3986 section 5.2 into out,
+    // which must be neither this URL nor hold reference. False if this URL
+    // is invalid and reference is not absolute.
+    bool Resolve(std::string_view reference, URL& out) const;
+
+    bool Valid() const { return m_schemeEnd != 0; }
+    const std::string& Spec() const { return m_spec; }
+
+    // What caches key on: the spec without its fragment, which never reaches
+    // the server.
+    std::string_view CacheKey() const { return std::string_view(m_spec).substr(0, m_fragmentBegin); }
+
+    // Components without their delimiters; empty when absent.
+    std::string_view Scheme() const { return Slice(0, m_schemeEnd); }
+    std::string_view Host() const { return Slice(m_hostBegin, m_hostEnd); }
+    std::string_view Port() const { return m_hostEnd < m_pathBegin ? Slice(m_hostEnd + 1, m_pathBegin) : std::string_view(); }
+    std::string_view Path() const { return Slice(m_pathBegin, m_queryBegin); }
+    std::string_view Query() const { return HasQuery() ? Slice(m_queryBegin + 1, m_fragmentBegin) : std::string_view(); }
+    std::string_view Fragment() const { return HasFragment() ? Slice(m_fragmentBegin + 1, m_spec.size()) : std::string_view(); }
+    bool HasAuthority() const { return m_hasAuthority; }
+    bool HasQuery() const { return m_queryBegin < m_fragmentBegin; }
+    bool HasFragment() const { return m_fragmentBegin < m_spec.size(); }
+
+private:
+    struct Parts;
+    static void Split(std::string_view reference, Parts& out);
+    void Build(const Parts& parts, std::string_view pathPrefix);
+    std::string_view Slice(uint32_t begin, uint32_t end) const {
+        return std::string_view(m_spec).substr(begin, end - begin);
+    }
+
+    std::string m_spec;
+    uint32_t m_schemeEnd = 0;  // the ':' after the scheme; 0 while invalid
+    uint32_t m_hostBegin = 0;
+    uint32_t m_hostEnd = 0;    // the ':' before the port, or m_pathBegin
+    uint32_t m_pathBegin = 0;
+    uint32_t m_queryBegin = 0;     // the '?', or where the fragment begins
+    uint32_t m_fragmentBegin = 0;  // the '#', or m_spec.size()
+    bool m_hasAuthority = false;
+};
+
+// Resolves an href/src against the URL of the page it appears on, giving
+// the canonical absolute URL. Data URLs pass through unchanged, an empty
+// reference yields "", and a base that is not an absolute URL leaves the
+// reference as it is.
+std::string ResolveURL(const std::string& base, const std::string& relative);
+
+// What caches key on for an absolute URL: all of it but the fragment, which
+// never reaches the server. Data URLs are kept whole, as a '#' in one is
+// part of its payload.
+std::string_view URLCacheKey(std::string_view url);
+
+// Small id standing for a URL, so a cache keyed on it compares integers
+// instead of strings.
+using URLId = uint64_t;
+
+// The URLs one owner is working with (a page's images, the loader's
+// requests, history) and their ids. Ids are handed out from 1 and reused once
+// released, so a table holds only what its owner still refers to. Data URLs
+// are never stored, as they run to megabytes: their id is a hash of the whole
+// URL with kHashedURL set.
+//
+// Not thread-safe, but a table nobody is adding to can be read from any
+// thread.
+class URLTable {
+public:
+    static constexpr URLId kHashedURL = URLId(1) << 61;  // ids stay below 1 << 62
+
+    // The id of URLCacheKey(url), adding it if new; each call takes one
+    // reference, given back by Release. 0 for "".
+    URLId Intern(std::string_view url);
+    // The id of URLCacheKey(url) if it is in the table, else 0.
+    URLId Find(std::string_view url) const;
+    // Drops a reference; the id is free for another URL after the last one.
+    void Release(URLId id);
+    // Forgets every URL and id.
+    void Clear();
+
+    // The cache key an id stands for; "" for 0, data URLs and free ids. Valid
+    // until the next Intern.
+    const std::string& Spelling(URLId id) const;
+    size_t Size() const { return m_count; }
+
+private:
+    struct Slot {
+        uint64_t hash = 0;
+        URLId id = 0;  // 0: empty
+    };
+    size_t FindSlot(std::string_view key, uint64_t hash) const;
+    void Grow();
+
+    std::vector<Slot> m_slots;           // open table of (hash, id), at most half full
+    std::vector<std::string> m_spellings;  // by id - 1
+    std::vector<uint32_t> m_refs;        // by id - 1; 0 when free
+    std::vector<URLId> m_free;
+    size_t m_count = 0;
+};